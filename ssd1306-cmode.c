@@ -74,6 +74,21 @@ int ssd1306_cmode_setup(struct ssd1306_cmode *cmode, int fonth, int fontv,
 		memset(cmode->actual_disp[line], 0, length);
 	}
 
+	cmode->line_attr = kmalloc_array(cmode->max_lines,
+					 sizeof(*cmode->line_attr), GFP_KERNEL);
+	if (!cmode->line_attr) {
+		for (line = 0; line < cmode->max_lines; line++)
+			kfree(cmode->actual_disp[line]);
+
+		goto exit;
+	}
+
+	//Lines are not scaled until user sets their attributes
+	for (line = 0; line < cmode->max_lines; line++) {
+		cmode->line_attr[line].scale_x = 1;
+		cmode->line_attr[line].scale_y = 1;
+	}
+
 	return 0;
 exit:
 	if (cmode->actual_disp)
@@ -101,8 +116,10 @@ void ssd1306_cmode_free(struct ssd1306_cmode *cmode)
 	}
 
 	kfree(cmode->actual_disp);
+	kfree(cmode->line_attr);
 
 	cmode->actual_disp = NULL;
+	cmode->line_attr = NULL;
 }
 
 /**
@@ -129,10 +146,14 @@ int ssd1306_cut_str(struct ssd1306_cmode* cmode, char* str)
 	len = strlen(position);
 
 	for (; line_num < cmode->max_lines; line_num++) {
+		//Scaled line fits less characters
+		const int cols = cmode->max_cols /
+				 cmode->line_attr[line_num].scale_x;
+
 		line = cmode->actual_disp[line_num];
 
 		for(col_num = 0; col_num < cmode->max_cols; col_num++) {
-			if (counter < len) {
+			if (counter < len && col_num < cols) {
 
 				/** The string could contains special characters
 				 *  like new line or carrier return and others
@@ -159,3 +180,47 @@ int ssd1306_cut_str(struct ssd1306_cmode* cmode, char* str)
 
 	return counter;
 }
+
+/**
+ * @brief
+ *     Overwrite characters of a line starting at the column, up to the end
+ *     of the line or a new line character. Empty cells before the column
+ *     become spaces, so the line stays a continuous string.
+ *
+ * @param[IN] cmode    pointer to character mode structure
+ * @param[IN] line     line number
+ * @param[IN] col      first column
+ * @param[IN] str      characters to write
+ * @param[IN] len      number of characters
+ *
+ * @return returns number of consumed characters or negative error
+ */
+int ssd1306_cmode_write(struct ssd1306_cmode *cmode, int line, int col,
+			const char *str, int len)
+{
+	char *text;
+	int count = 0;
+	int i;
+
+	if (!cmode || !str || line < 0 || line >= cmode->max_lines ||
+	    col < 0 || col >= cmode->max_cols)
+		return -EINVAL;
+
+	text = cmode->actual_disp[line];
+
+	for (i = 0; i < col; i++)
+		if (!text[i])
+			text[i] = ' ';
+
+	while (count < len && col < cmode->max_cols) {
+		const char c = str[count++];
+
+		if (c == '\n')
+			break;
+
+		//Unsupported characters take their cell as a space
+		text[col++] = ALFANUM(c) ? c : ' ';
+	}
+
+	return count;
+}
@@ -0,0 +1,325 @@
+// SPDX-License-Identifier: (GPL-2.0 OR MIT)
+
+#include <linux/kernel.h>
+#include <linux/version.h>
+#include <linux/console.h>
+#include <linux/font.h>
+#include <linux/i2c.h>
+#include <linux/spinlock.h>
+#include <linux/mutex.h>
+#include <linux/notifier.h>
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 14, 0)
+#include <linux/panic_notifier.h>
+#endif
+
+#include "ssd1306.h"
+#include "ssd1306-font.h"
+#include "ssd1306-console.h"
+
+#define CONSOLE_COLS     (SSD1306_HORIZONTAL_MAX / DEFAULT_FONT_WIDTH)
+#define CONSOLE_LINES    (SSD1306_VERTICAL_MAX / DEFAULT_FONT_HEIGHT)
+#define CONSOLE_GLYPHS   256
+#define CONSOLE_INTERVAL (HZ / 4)
+
+/**
+ * Everything needed by the panic path is allocated statically and prepared
+ * during registration, so painting the panel needs no memory allocation,
+ * no font lookup and no sleeping lock.
+ */
+static struct {
+	struct ssd1306 *oled;
+	struct i2c_client *client;
+	spinlock_t lock;
+	char text[CONSOLE_LINES][CONSOLE_COLS]; /*! Ring of the last lines */
+	int line;                      /*! Ring index of the newest line */
+	int col;                       /*! Next column in the newest line */
+	bool newline;                  /*! Line feed waits for next character */
+	bool painted;                  /*! Panel shows the shown pages */
+	unsigned long next;            /*! Jiffies of the next oops repaint */
+	uint8_t glyphs[CONSOLE_GLYPHS][DEFAULT_FONT_WIDTH]; /*! Page format */
+	uint8_t page[1 + SSD1306_HORIZONTAL_MAX]; /*! Data stream of one page */
+	uint8_t shown[CONSOLE_LINES][SSD1306_HORIZONTAL_MAX]; /*! Panel pages */
+} ssd1306_con;
+
+/**
+ * @brief
+ *     Transpose default font glyphs from rows to page format columns
+ *
+ * @return returns zero or negative error
+ */
+static int ssd1306_console_load_font(void)
+{
+	const struct font_desc *font;
+	const uint8_t *rows;
+	int c, x, y;
+
+	font = get_default_font(SSD1306_HORIZONTAL_MAX, SSD1306_VERTICAL_MAX,
+				DEFAULT_FONT_WIDTH, DEFAULT_FONT_HEIGHT);
+	if (!font || font->width != DEFAULT_FONT_WIDTH ||
+	    font->height != DEFAULT_FONT_HEIGHT) {
+		LOG(KERN_DEBUG, "Console font does not exist");
+		return -ENOENT;
+	}
+
+	for (c = 0; c < CONSOLE_GLYPHS; c++) {
+		rows = (const uint8_t *)font->data + c * DEFAULT_FONT_HEIGHT;
+
+		for (x = 0; x < DEFAULT_FONT_WIDTH; x++) {
+			uint8_t column = 0;
+
+			for (y = 0; y < DEFAULT_FONT_HEIGHT; y++)
+				if (rows[y] & (0x80 >> x))
+					column |= 1 << y;
+
+			ssd1306_con.glyphs[c][x] = column;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * @brief
+ *     Send one message using the atomic transfer of the adapter, the only
+ *     one allowed with interrupts disabled
+ *
+ * @param[IN] adapter    I2C adapter of the display
+ * @param[IN] msg        message to send
+ *
+ * @return returns zero or negative error
+ */
+static int ssd1306_console_xfer(struct i2c_adapter *adapter,
+				struct i2c_msg *msg)
+{
+	int err;
+
+	err = adapter->algo->master_xfer_atomic(adapter, msg, 1);
+	if (err < 0)
+		return err;
+
+	return err == 1 ? 0 : -EIO;
+}
+
+/**
+ * @brief
+ *     Render the ring into pages, the oldest line on top, and send the pages
+ *     that differ from the panel. Latency is bounded by two transfers per
+ *     page. Before panic nothing is sent while the I2C bus or the driver
+ *     is busy.
+ *
+ * @param[IN] panic    other CPUs are stopped, do not take the bus lock
+ */
+static void ssd1306_console_flush(bool panic)
+{
+	struct i2c_adapter *adapter = ssd1306_con.client->adapter;
+	struct i2c_msg msg = {
+		.addr = ssd1306_con.client->addr,
+		.flags = 0,
+	};
+	uint8_t cmds[] = {
+		0x00,
+		SET_MEMORY_ADDR_MODE, 0x00,
+		SET_COL_ADRS, 0, SSD1306_HORIZONTAL_MAX - 1,
+		SET_PAGE_ADRS, 0, 0,
+		SET_DISP_ON,
+	};
+	int row, col;
+
+	//Bus owner could be interrupted on this CPU, never wait for it
+	if (!panic && !i2c_trylock_bus(adapter, I2C_LOCK_SEGMENT))
+		return;
+
+	/* Window and display state change behind the driver. The driver trusts
+	 * its cached window under oled->lock, so drop the cache first and do
+	 * not paint while the driver may be in the middle of a transfer.
+	 */
+	ssd1306_state_invalidate(ssd1306_con.oled);
+	smp_mb();
+	if (!panic && mutex_is_locked(&ssd1306_con.oled->lock))
+		goto unlock;
+
+	for (row = 0; row < CONSOLE_LINES; row++) {
+		const char *text = ssd1306_con.text[(ssd1306_con.line + 1 +
+						     row) % CONSOLE_LINES];
+		uint8_t *dst = &ssd1306_con.page[DISP_BUFF_OFFSET];
+
+		for (col = 0; col < CONSOLE_COLS; col++) {
+			memcpy(dst, ssd1306_con.glyphs[(uint8_t)text[col]],
+			       DEFAULT_FONT_WIDTH);
+			dst += DEFAULT_FONT_WIDTH;
+		}
+
+		if (ssd1306_con.painted &&
+		    !memcmp(ssd1306_con.shown[row],
+			    &ssd1306_con.page[DISP_BUFF_OFFSET],
+			    SSD1306_HORIZONTAL_MAX))
+			continue;
+
+		//Panel RAM no longer matches the mirror of the driver
+		ssd1306_con.oled->sent_stale = true;
+
+		cmds[7] = row;
+		cmds[8] = row;
+		msg.buf = cmds;
+		msg.len = sizeof(cmds);
+		if (ssd1306_console_xfer(adapter, &msg))
+			break;
+
+		msg.buf = ssd1306_con.page;
+		msg.len = sizeof(ssd1306_con.page);
+		if (ssd1306_console_xfer(adapter, &msg))
+			break;
+
+		memcpy(ssd1306_con.shown[row],
+		       &ssd1306_con.page[DISP_BUFF_OFFSET],
+		       SSD1306_HORIZONTAL_MAX);
+	}
+
+	ssd1306_con.painted = row == CONSOLE_LINES;
+
+unlock:
+	if (!panic)
+		i2c_unlock_bus(adapter, I2C_LOCK_SEGMENT);
+}
+
+/**
+ * @brief
+ *     Store kernel messages in the ring. The panel is painted only while
+ *     an oops or panic is in progress, at most every CONSOLE_INTERVAL
+ *     during an oops, the panic notifier paints the final state.
+ */
+static void ssd1306_console_write(struct console *con, const char *str,
+				  unsigned int len)
+{
+	unsigned long flags;
+	char *line;
+
+	if (oops_in_progress) {
+		if (!spin_trylock_irqsave(&ssd1306_con.lock, flags))
+			return;
+	} else {
+		spin_lock_irqsave(&ssd1306_con.lock, flags);
+	}
+
+	for (; len; len--, str++) {
+		if (*str == '\n') {
+			ssd1306_con.newline = true;
+			continue;
+		}
+
+		if (*str == '\r')
+			continue;
+
+		if (ssd1306_con.newline || ssd1306_con.col == CONSOLE_COLS) {
+			ssd1306_con.line = (ssd1306_con.line + 1) %
+					   CONSOLE_LINES;
+			ssd1306_con.col = 0;
+			ssd1306_con.newline = false;
+			memset(ssd1306_con.text[ssd1306_con.line], ' ',
+			       CONSOLE_COLS);
+		}
+
+		line = ssd1306_con.text[ssd1306_con.line];
+		line[ssd1306_con.col++] = *str;
+	}
+
+	if (oops_in_progress &&
+	    time_after_eq(jiffies, ssd1306_con.next)) {
+		ssd1306_console_flush(false);
+		ssd1306_con.next = jiffies + CONSOLE_INTERVAL;
+	}
+
+	spin_unlock_irqrestore(&ssd1306_con.lock, flags);
+}
+
+static int ssd1306_console_panic(struct notifier_block *nb,
+				 unsigned long event, void *msg)
+{
+	//Lock could be held by stopped CPU, the ring is good enough anyway
+	//The driver could have painted over the console since the last oops
+	ssd1306_con.painted = false;
+	ssd1306_console_flush(true);
+
+	return NOTIFY_DONE;
+}
+
+static struct console ssd1306_console = {
+	.name = "oled",
+	.write = ssd1306_console_write,
+	.flags = CON_ENABLED | CON_PRINTBUFFER | CON_ANYTIME,
+	.index = -1,
+};
+
+static struct notifier_block ssd1306_panic_nb = {
+	.notifier_call = ssd1306_console_panic,
+};
+
+/**
+ * @brief
+ *     Register kernel console showing the last kernel messages on the
+ *     display after oops or panic
+ *
+ * @param[IN] oled    pointer to SSD1306 main handle
+ *
+ * @return returns zero or negative error
+ */
+int ssd1306_console_register(struct ssd1306 *oled)
+{
+	struct i2c_adapter *adapter;
+	int err;
+
+	if (!oled || !oled->i2c_client)
+		return -EPERM;
+
+	//Only one display shows the console
+	if (ssd1306_con.client)
+		return -EBUSY;
+
+	adapter = oled->i2c_client->adapter;
+	if (!adapter->algo || !adapter->algo->master_xfer_atomic) {
+		LOG(KERN_WARNING, "I2C adapter has no atomic transfer, "
+		    "console is not available");
+		return -EOPNOTSUPP;
+	}
+
+	err = ssd1306_console_load_font();
+	if (err)
+		return err;
+
+	spin_lock_init(&ssd1306_con.lock);
+	memset(ssd1306_con.text, ' ', sizeof(ssd1306_con.text));
+	ssd1306_con.line = 0;
+	ssd1306_con.col = 0;
+	ssd1306_con.newline = false;
+	ssd1306_con.painted = false;
+	ssd1306_con.next = jiffies;
+	ssd1306_con.page[0] = SET_DISP_START_LINE;
+	ssd1306_con.oled = oled;
+	ssd1306_con.client = oled->i2c_client;
+
+	register_console(&ssd1306_console);
+	atomic_notifier_chain_register(&panic_notifier_list,
+				       &ssd1306_panic_nb);
+
+	LOG(KERN_DEBUG, "Kernel console registered");
+
+	return 0;
+}
+
+/**
+ * @brief
+ *     Unregister kernel console
+ *
+ * @param[IN] oled    pointer to SSD1306 main handle
+ */
+void ssd1306_console_unregister(struct ssd1306 *oled)
+{
+	if (!ssd1306_con.client || ssd1306_con.client != oled->i2c_client)
+		return;
+
+	atomic_notifier_chain_unregister(&panic_notifier_list,
+					 &ssd1306_panic_nb);
+	unregister_console(&ssd1306_console);
+
+	ssd1306_con.client = NULL;
+}
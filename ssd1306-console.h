@@ -0,0 +1,15 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+
+#ifdef CONFIG_SSD1306_CONSOLE
+int ssd1306_console_register(struct ssd1306 *oled);
+void ssd1306_console_unregister(struct ssd1306 *oled);
+#else
+static inline int ssd1306_console_register(struct ssd1306 *oled)
+{
+	return 0;
+}
+
+static inline void ssd1306_console_unregister(struct ssd1306 *oled)
+{
+}
+#endif
@@ -0,0 +1,165 @@
+// SPDX-License-Identifier: (GPL-2.0 OR MIT)
+
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/i2c.h>
+#include <linux/crc32.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+
+#include "ssd1306.h"
+#include "ssd1306-debugfs.h"
+
+/**
+ * Per device debugfs directory ssd1306-<i2c device>:
+ *     frame.pbm        display buffer, what the driver wants on the panel
+ *     last_sent.pbm    data the panel received so far
+ *     crc32            CRC32 of every page of both buffers
+ */
+
+/**
+ * @brief
+ *     Take a consistent copy of the page data of the display buffer
+ *
+ * @return returns zero or negative error
+ */
+static int ssd1306_debugfs_copy(struct ssd1306 *oled, const uint8_t *src,
+				uint8_t *dst)
+{
+	if (mutex_lock_interruptible(&oled->lock))
+		return -ERESTARTSYS;
+
+	memcpy(dst, &src[DISP_BUFF_OFFSET], DISP_BUFF_SIZE - DISP_BUFF_OFFSET);
+
+	mutex_unlock(&oled->lock);
+
+	return 0;
+}
+
+/**
+ * @brief
+ *     Print page data as binary PBM (P4) image
+ */
+static int ssd1306_debugfs_pbm(struct seq_file *s, const uint8_t *src)
+{
+	struct ssd1306 *oled = s->private;
+	uint8_t row[SSD1306_HORIZONTAL_MAX / 8];
+	uint8_t *pages;
+	int x, y, err;
+
+	pages = kmalloc(DISP_BUFF_SIZE, GFP_KERNEL);
+	if (!pages)
+		return -ENOMEM;
+
+	err = ssd1306_debugfs_copy(oled, src, pages);
+	if (err)
+		goto exit;
+
+	seq_printf(s, "P4\n%d %d\n", SSD1306_HORIZONTAL_MAX,
+		   SSD1306_VERTICAL_MAX);
+
+	for (y = 0; y < SSD1306_VERTICAL_MAX; y++) {
+		const uint8_t *page = &pages[(y / SSD1306_CELL_CAPACITY) *
+					     SSD1306_HORIZONTAL_MAX];
+		const uint8_t bit = 1 << (y % SSD1306_CELL_CAPACITY);
+
+		memset(row, 0, sizeof(row));
+		for (x = 0; x < SSD1306_HORIZONTAL_MAX; x++)
+			if (page[x] & bit)
+				row[x / 8] |= 0x80 >> (x % 8);
+
+		seq_write(s, row, sizeof(row));
+	}
+
+exit:
+	kfree(pages);
+
+	return err;
+}
+
+static int ssd1306_frame_show(struct seq_file *s, void *unused)
+{
+	struct ssd1306 *oled = s->private;
+
+	return ssd1306_debugfs_pbm(s, oled->disp_buff);
+}
+DEFINE_SHOW_ATTRIBUTE(ssd1306_frame);
+
+static int ssd1306_last_sent_show(struct seq_file *s, void *unused)
+{
+	struct ssd1306 *oled = s->private;
+
+	return ssd1306_debugfs_pbm(s, oled->sent_buff);
+}
+DEFINE_SHOW_ATTRIBUTE(ssd1306_last_sent);
+
+static int ssd1306_crc32_show(struct seq_file *s, void *unused)
+{
+	struct ssd1306 *oled = s->private;
+	uint8_t *frame, *sent;
+	int page, err;
+
+	frame = kmalloc(DISP_BUFF_SIZE, GFP_KERNEL);
+	sent = kmalloc(DISP_BUFF_SIZE, GFP_KERNEL);
+	if (!frame || !sent) {
+		err = -ENOMEM;
+		goto exit;
+	}
+
+	err = ssd1306_debugfs_copy(oled, oled->disp_buff, frame);
+	if (!err)
+		err = ssd1306_debugfs_copy(oled, oled->sent_buff, sent);
+	if (err)
+		goto exit;
+
+	seq_puts(s, "page frame    sent\n");
+	for (page = 0; page < SSD1306_PAGES; page++) {
+		const int base = page * SSD1306_HORIZONTAL_MAX;
+
+		seq_printf(s, "%-4d %08x %08x\n", page,
+			   crc32(~0, &frame[base], SSD1306_HORIZONTAL_MAX) ^ ~0,
+			   crc32(~0, &sent[base], SSD1306_HORIZONTAL_MAX) ^ ~0);
+	}
+
+exit:
+	kfree(frame);
+	kfree(sent);
+
+	return err;
+}
+DEFINE_SHOW_ATTRIBUTE(ssd1306_crc32);
+
+/**
+ * @brief
+ *     Create debugfs directory of the device. Failures are not fatal.
+ *
+ * @param[IN] oled    pointer to SSD1306 main handle
+ */
+void ssd1306_debugfs_add(struct ssd1306 *oled)
+{
+	char name[32];
+
+	snprintf(name, sizeof(name), DEVICE_NAME "-%s",
+		 dev_name(&oled->i2c_client->dev));
+
+	oled->debugfs = debugfs_create_dir(name, NULL);
+
+	debugfs_create_file("frame.pbm", 0444, oled->debugfs, oled,
+			    &ssd1306_frame_fops);
+	debugfs_create_file("last_sent.pbm", 0444, oled->debugfs, oled,
+			    &ssd1306_last_sent_fops);
+	debugfs_create_file("crc32", 0444, oled->debugfs, oled,
+			    &ssd1306_crc32_fops);
+}
+
+/**
+ * @brief
+ *     Remove debugfs directory of the device
+ *
+ * @param[IN] oled    pointer to SSD1306 main handle
+ */
+void ssd1306_debugfs_remove(struct ssd1306 *oled)
+{
+	debugfs_remove_recursive(oled->debugfs);
+	oled->debugfs = NULL;
+}
@@ -0,0 +1,4 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+
+void ssd1306_debugfs_add(struct ssd1306 *oled);
+void ssd1306_debugfs_remove(struct ssd1306 *oled);
@@ -1,6 +1,8 @@
 // SPDX-License-Identifier: (GPL-2.0 OR MIT)
 
 #include <linux/i2c.h>
+#include <linux/bitops.h>
+#include <asm/unaligned.h>
 
 #include "ssd1306.h"
 #include "ssd1306-font.h"
@@ -9,6 +11,18 @@
 #define SSD1306_ADDRESS    0x3C
 #define SSD1306_CONTROL    0x00
 
+/* Bytes on the bus worth one more transfer: column window command with two
+ * arguments, three SMBus writes of three bytes, plus address and control
+ * byte of the data stream. Shorter gaps are cheaper to send.
+ */
+#define SSD1306_WINDOW_COST    (3 * 3 + 2)
+#define SSD1306_RUNS_MAX       16
+
+struct ssd1306_run {
+	int start;   /*! First changed column */
+	int end;     /*! Last changed column (inclusive) */
+};
+
 static int send_cmd(struct ssd1306 *oled, enum ssd1306_cmd cmd)
 {
 	if (!oled) {
@@ -26,6 +40,138 @@ static int send_cmd(struct ssd1306 *oled, enum ssd1306_cmd cmd)
 	return i2c_smbus_write_byte_data(oled->i2c_client, 0x00, (u8)cmd);
 }
 
+/**
+ * @brief
+ *     Forget cached controller configuration, following commands are sent
+ *     unconditionally. Used after reset, resume and failed transfers.
+ *
+ * @param[IN] oled    pointer to SSD1306 main handle
+ */
+void ssd1306_state_invalidate(struct ssd1306 *oled)
+{
+	//Every field becomes -1
+	memset(&oled->state, 0xFF, sizeof(oled->state));
+}
+
+/**
+ * @brief
+ *     Send single byte command unless the controller state already is the
+ *     one selected by it
+ *
+ * @param[IN] oled      pointer to SSD1306 main handle
+ * @param[IN] shadow    cached register state
+ * @param[IN] cmd       command to send
+ *
+ * @return returns zero or negative error
+ */
+static int send_cmd_cached(struct ssd1306 *oled, int *shadow, uint8_t cmd)
+{
+	int err;
+
+	if (*shadow == cmd)
+		return 0;
+
+	err = send_cmd(oled, cmd);
+	if (err) {
+		ssd1306_state_invalidate(oled);
+		return err;
+	}
+
+	*shadow = cmd;
+
+	return 0;
+}
+
+/**
+ * @brief
+ *     Send command with single argument unless the controller register
+ *     already holds the argument
+ *
+ * @param[IN] oled      pointer to SSD1306 main handle
+ * @param[IN] shadow    cached register value
+ * @param[IN] cmd       command to send
+ * @param[IN] arg       command argument
+ *
+ * @return returns zero or negative error
+ */
+static int send_cmd_arg_cached(struct ssd1306 *oled, int *shadow,
+			       enum ssd1306_cmd cmd, uint8_t arg)
+{
+	int err;
+
+	if (*shadow == arg)
+		return 0;
+
+	err = send_cmd(oled, cmd);
+	err |= send_cmd(oled, arg);
+	if (err) {
+		ssd1306_state_invalidate(oled);
+		return err;
+	}
+
+	*shadow = arg;
+
+	return 0;
+}
+
+/**
+ * @brief
+ *     Select horizontal addressing and the window for following display
+ *     data. Unchanged window is not sent again: after a complete transfer
+ *     of the window the controller pointer wraps back to its start.
+ *
+ * @param[IN] oled          pointer to SSD1306 main handle
+ * @param[IN] col_start     first column
+ * @param[IN] page_start    first page
+ * @param[IN] col_end       last column (inclusive)
+ * @param[IN] page_end      last page (inclusive)
+ *
+ * @return returns zero or negative error
+ */
+static int ssd1306_set_window(struct ssd1306 *oled, int col_start,
+			      int page_start, int col_end, int page_end)
+{
+	struct ssd1306_state *state = &oled->state;
+	int err;
+
+	err = send_cmd_arg_cached(oled, &state->addr_mode,
+				  SET_MEMORY_ADDR_MODE, 0x00);
+	if (err) {
+		LOG(KERN_DEBUG, "Reset memory address mode failed");
+		return err;
+	}
+
+	if (state->col_start != col_start || state->col_end != col_end) {
+		err = send_cmd(oled, SET_COL_ADRS);
+		err |= send_cmd(oled, col_start);
+		err |= send_cmd(oled, col_end);
+		if (err) {
+			LOG(KERN_DEBUG, "Set column address failed");
+			ssd1306_state_invalidate(oled);
+			return err;
+		}
+
+		state->col_start = col_start;
+		state->col_end = col_end;
+	}
+
+	if (state->page_start != page_start || state->page_end != page_end) {
+		err = send_cmd(oled, SET_PAGE_ADRS);
+		err |= send_cmd(oled, page_start);
+		err |= send_cmd(oled, page_end);
+		if (err) {
+			LOG(KERN_DEBUG, "Set page address failed");
+			ssd1306_state_invalidate(oled);
+			return err;
+		}
+
+		state->page_start = page_start;
+		state->page_end = page_end;
+	}
+
+	return 0;
+}
+
 /**
  * @brief
  *     Place a single pixel at the x and y coordinates
@@ -39,13 +185,33 @@ static int send_cmd(struct ssd1306 *oled, enum ssd1306_cmd cmd)
  * @return returns zero or negative error
  */
 int ssd1306_draw_pxl(struct ssd1306 *oled, int x, int y)
+{
+	if (!oled)
+		return -EPERM;
+
+	return ssd1306_draw_pxl_buff(oled, oled->canvas, x, y);
+}
+
+/**
+ * @brief
+ *     Place a single pixel at the x and y coordinates of any buffer laid out
+ *     like the canvas (leading command byte, then page data).
+ *
+ * @param[IN]    oled    pointer to SSD1306 main handle
+ * @param[IN]    buff    pointer to the page buffer
+ * @param[IN]    y       vertical coordinate
+ * @param[IN]    x       horizontal coordinate
+ *
+ * @return returns zero or negative error
+ */
+int ssd1306_draw_pxl_buff(struct ssd1306 *oled, uint8_t *buff, int x, int y)
 {
 	int cell_addr;
 	int row;
 	uint8_t bit;
-	const int offset = sizeof(SET_DISP_START_LINE);
+	const int offset = DISP_BUFF_OFFSET;
 
-	if (!oled)
+	if (!oled || !buff)
 		return -EPERM;
 
 	if ( x < 0 || y < 0) {
@@ -53,21 +219,21 @@ int ssd1306_draw_pxl(struct ssd1306 *oled, int x, int y)
 		return -EPERM;
 	}
 
-	if (x >= SSD1306_HORIZONTAL_MAX) {
+	if (x >= ssd1306_width(oled)) {
 		LOG(KERN_DEBUG, "Coordinate x has to be smaller then %d",
-		    SSD1306_HORIZONTAL_MAX);
+		    ssd1306_width(oled));
 		return -EPERM;
 	}
 
-	if (y >= SSD1306_VERTICAL_MAX) {
+	if (y >= ssd1306_height(oled)) {
 		LOG(KERN_DEBUG, "Coordinate y has to be smaller then %d",
-		    SSD1306_VERTICAL_MAX);
+		    ssd1306_height(oled));
 		return -EPERM;
 	}
 
 	row = y / SSD1306_CELL_CAPACITY;
 	//Calculate cell address and add needed offset for command in DMA stream
-	cell_addr = (x + row * SSD1306_HORIZONTAL_MAX) + offset;
+	cell_addr = (x + row * ssd1306_width(oled)) + offset;
 	bit = (1 << y%SSD1306_CELL_CAPACITY);
 
 	//Should never happen in theory
@@ -76,49 +242,475 @@ int ssd1306_draw_pxl(struct ssd1306 *oled, int x, int y)
 		return -ERANGE;
 	}
 
-	oled->disp_buff[cell_addr] |= bit;
+	buff[cell_addr] |= bit;
 
 	return 0;
 }
 
 /**
  * @brief
- *     Send buffer content to the driver
+ *     Account a new frame handed to the bus
  *
  * @param[IN] oled    pointer to SSD1306 main handle
+ */
+static void ssd1306_frame_start(struct ssd1306 *oled)
+{
+	atomic64_inc(&oled->frame_submitted);
+}
+
+/**
+ * @brief
+ *     Account finished frame, store its result and wake up waiters
+ *
+ * @param[IN] oled    pointer to SSD1306 main handle
+ * @param[IN] err     result of the transfer
+ */
+static void ssd1306_frame_end(struct ssd1306 *oled, int err)
+{
+	oled->frame_err = err;
+	oled->frame_time = ktime_get();
+	atomic64_set(&oled->frame_completed,
+		     atomic64_read(&oled->frame_submitted));
+	wake_up_interruptible_all(&oled->frame_wait);
+}
+
+/**
+ * @brief
+ *     Forget all changed areas, the panel content matches the display buffer
+ *
+ * @param[IN] oled    pointer to SSD1306 main handle
+ */
+static void ssd1306_clear_dirty(struct ssd1306 *oled)
+{
+	int page;
+
+	for (page = 0; page < SSD1306_PAGES; page++) {
+		oled->dirty_start[page] = SSD1306_HORIZONTAL_MAX;
+		oled->dirty_end[page] = -1;
+	}
+}
+
+/**
+ * @brief
+ *     Mark rectangle of the display buffer as changed. Marked columns are
+ *     sent to the panel by the next ssd1306_display_dirty() call.
+ *
+ * @param[IN] oled    pointer to SSD1306 main handle
+ * @param[IN] x0      first column
+ * @param[IN] y0      first row
+ * @param[IN] x1      last column (inclusive)
+ * @param[IN] y1      last row (inclusive)
+ */
+void ssd1306_mark_dirty(struct ssd1306 *oled, int x0, int y0, int x1, int y1)
+{
+	int page;
+
+	x0 = max(x0, 0);
+	y0 = max(y0, 0);
+	x1 = min(x1, SSD1306_HORIZONTAL_MAX - 1);
+	y1 = min(y1, SSD1306_VERTICAL_MAX - 1);
+
+	if (x0 > x1 || y0 > y1)
+		return;
+
+	for (page = y0 / SSD1306_CELL_CAPACITY;
+	     page <= y1 / SSD1306_CELL_CAPACITY; page++) {
+		oled->dirty_start[page] = min(oled->dirty_start[page], x0);
+		oled->dirty_end[page] = max(oled->dirty_end[page], x1);
+	}
+}
+
+/**
+ * @brief
+ *     Send rectangular window of the display buffer to the panel. The window
+ *     is given in columns and pages (8 pixel rows).
+ *
+ * @param[IN] oled          pointer to SSD1306 main handle
+ * @param[IN] col_start     first column
+ * @param[IN] page_start    first page
+ * @param[IN] col_end       last column (inclusive)
+ * @param[IN] page_end      last page (inclusive)
  *
  * @return returns zero or negative error
  */
-int ssd1306_display(struct ssd1306 *oled)
+int ssd1306_display_area(struct ssd1306 *oled, int col_start, int page_start,
+			 int col_end, int page_end)
 {
+	const int width = col_end - col_start + 1;
+	int win_start, win_end;
+	int page, len, shift;
 	int err;
 
-	if (!oled)
+	if (!oled || !oled->tx_buff)
 		return -EPERM;
 
-	err = send_cmd(oled, SET_MEMORY_ADDR_MODE);
-	err |= send_cmd(oled, 0x00);
-	if (err) {
-		LOG(KERN_DEBUG, "Reset memory address mode failed");
+	shift = oled->shift_x;
+
+	if (col_start < 0 || col_end >= SSD1306_HORIZONTAL_MAX || width <= 0 ||
+	    page_start < 0 || page_end >= SSD1306_PAGES ||
+	    page_start > page_end)
+		return -EINVAL;
+
+	/* Orbit moves the image right by shift columns: the area is sent to
+	 * shifted columns, the right edge falls off the panel and the left
+	 * edge is kept blank by areas starting at the first column.
+	 */
+	if (col_start + shift >= SSD1306_HORIZONTAL_MAX)
+		goto sent;
+
+	win_start = col_start ? col_start + shift : 0;
+	win_end = min(col_end + shift, SSD1306_HORIZONTAL_MAX - 1);
+
+	err = ssd1306_set_window(oled, win_start, page_start, win_end,
+				 page_end);
+	if (err)
 		return err;
+
+	//Gather the window rows behind the data stream command
+	oled->tx_buff[0] = SET_DISP_START_LINE;
+	len = DISP_BUFF_OFFSET;
+	for (page = page_start; page <= page_end; page++) {
+		const int blank = col_start ? 0 : shift;
+		const int data = win_end - win_start + 1 - blank;
+
+		memset(&oled->tx_buff[len], 0, blank);
+		len += blank;
+		memcpy(&oled->tx_buff[len], &oled->disp_buff[DISP_BUFF_OFFSET +
+		       col_start + page * SSD1306_HORIZONTAL_MAX], data);
+		len += data;
 	}
 
-	err = send_cmd(oled, SET_COL_ADRS);
-	err |= send_cmd(oled, 0x00);
-	err |= send_cmd(oled, 127);
+	err = i2c_master_send(oled->i2c_client, oled->tx_buff, len);
+	if (err < 0) {
+		LOG(KERN_DEBUG, "Display area refresh failure");
+		ssd1306_state_invalidate(oled);
+		return err;
+	}
+
+	/* Controller pointer is somewhere inside the window, the panel RAM is
+	 * unknown until the next whole frame
+	 */
+	if (err != len) {
+		LOG(KERN_DEBUG, "Display area refreshed incompletely");
+		ssd1306_state_invalidate(oled);
+		oled->sent_stale = true;
+		return -EIO;
+	}
+
+sent:
+	for (page = page_start; page <= page_end; page++) {
+		const int base = DISP_BUFF_OFFSET + col_start +
+				 page * SSD1306_HORIZONTAL_MAX;
+
+		memcpy(&oled->sent_buff[base], &oled->disp_buff[base], width);
+	}
+
+	return 0;
+}
+
+/**
+ * @brief
+ *     Copy 8x8 block of the transposed canvas to the display buffer. Canvas
+ *     column lx, row ly lands in panel column (width - 1 - ly), row lx,
+ *     which is 90 degrees clockwise rotation; 270 degrees adds the hardware
+ *     180 degrees rotation on top. Changed columns are marked dirty.
+ *
+ * @param[IN] oled     pointer to SSD1306 main handle
+ * @param[IN] page     canvas page of the block
+ * @param[IN] block    canvas column of the block divided by 8
+ */
+static void ssd1306_rotate_block(struct ssd1306 *oled, int page, int block)
+{
+	const uint8_t *src = &oled->canvas[DISP_BUFF_OFFSET + page * oled->width +
+					   block * SSD1306_CELL_CAPACITY];
+	const int col = SSD1306_HORIZONTAL_MAX - SSD1306_CELL_CAPACITY -
+			page * SSD1306_CELL_CAPACITY;
+	uint8_t *dst = &oled->disp_buff[DISP_BUFF_OFFSET + col +
+					block * SSD1306_HORIZONTAL_MAX];
+	u64 pxls = 0;
+	int i;
+
+	for (i = 0; i < SSD1306_CELL_CAPACITY; i++)
+		pxls |= (u64)src[i] << (8 * i);
+
+	pxls = ssd1306_transpose8(pxls);
+
+	//Byte i holds canvas row i, it goes to the columns from the right
+	for (i = 0; i < SSD1306_CELL_CAPACITY; i++) {
+		const uint8_t column = pxls >> (8 * i);
+		const int x = SSD1306_CELL_CAPACITY - 1 - i;
+
+		if (dst[x] == column)
+			continue;
+
+		dst[x] = column;
+		ssd1306_mark_dirty(oled, col + x,
+				   block * SSD1306_CELL_CAPACITY, col + x,
+				   block * SSD1306_CELL_CAPACITY);
+	}
+}
+
+/**
+ * @brief
+ *     Rotate rectangle of the transposed canvas into the display buffer
+ *
+ * @param[IN] oled    pointer to SSD1306 main handle
+ * @param[IN] x0      first canvas column
+ * @param[IN] y0      first canvas row
+ * @param[IN] x1      last canvas column (inclusive)
+ * @param[IN] y1      last canvas row (inclusive)
+ */
+void ssd1306_rotate_area(struct ssd1306 *oled, int x0, int y0, int x1, int y1)
+{
+	int page, block;
+
+	for (page = y0 / SSD1306_CELL_CAPACITY;
+	     page <= y1 / SSD1306_CELL_CAPACITY; page++)
+		for (block = x0 / SSD1306_CELL_CAPACITY;
+		     block <= x1 / SSD1306_CELL_CAPACITY; block++)
+			ssd1306_rotate_block(oled, page, block);
+}
+
+/**
+ * @brief
+ *     Set rotation and mirroring. 180 degrees and mirroring are done by
+ *     the segment re-map and COM scan direction. 90 and 270 degrees swap
+ *     canvas width and height, the canvas is transposed block by block
+ *     while it is composed. Whole frame is sent again, because segment
+ *     re-map affects only data written after it.
+ * @note
+ *     Caller has to hold oled->lock. Canvas geometry can be changed only
+ *     if no file is open.
+ *
+ * @param[IN] oled        pointer to SSD1306 main handle
+ * @param[IN] rotation    clockwise rotation: 0, 90, 180 or 270
+ * @param[IN] mirror_x    mirror panel columns
+ * @param[IN] mirror_y    mirror panel rows
+ *
+ * @return returns zero or negative error
+ */
+int ssd1306_set_orientation(struct ssd1306 *oled, int rotation, bool mirror_x,
+			    bool mirror_y)
+{
+	const bool transposed = rotation == 90 || rotation == 270;
+	bool flip;
+	int seg_remap;
+	int err;
+
+	if (rotation != 0 && rotation != 90 && rotation != 180 &&
+	    rotation != 270)
+		return -EINVAL;
+
+#ifdef CONFIG_SSD1306_FIXED_GEOMETRY
+	//Canvas geometry is built in
+	if (transposed)
+		return -EOPNOTSUPP;
+#endif
+
+	if (transposed != ssd1306_transposed(oled)) {
+		if (!list_empty(&oled->layers))
+			return -EBUSY;
+
+		//Content of the old geometry is meaningless now
+		memset(oled->base_buff, 0, DISP_BUFF_SIZE);
+		memset(oled->rot_buff, 0, DISP_BUFF_SIZE);
+		ssd1306_clear_display(oled);
+
+		oled->canvas = transposed ? oled->rot_buff : oled->disp_buff;
+		oled->width = transposed ? SSD1306_VERTICAL_MAX :
+					   SSD1306_HORIZONTAL_MAX;
+		oled->height = transposed ? SSD1306_HORIZONTAL_MAX :
+					    SSD1306_VERTICAL_MAX;
+	}
+
+	oled->rotation = rotation;
+	oled->mirror_x = mirror_x;
+	oled->mirror_y = mirror_y;
+
+	flip = rotation == 180 || rotation == 270;
+	seg_remap = SET_SEG_REMAP | (flip ^ mirror_x);
+
+	//Re-map applies to written data only, panel content has to be resent
+	if (oled->state.seg_remap != seg_remap)
+		oled->sent_stale = true;
+
+	err = send_cmd_cached(oled, &oled->state.seg_remap, seg_remap);
 	if (err) {
-		LOG(KERN_DEBUG, "Set column address failed");
+		LOG(KERN_DEBUG, "Set segment re-map failed");
 		return err;
 	}
 
-	err = send_cmd(oled, SET_PAGE_ADRS);
-	err |= send_cmd(oled, 0x00);
-	err |= send_cmd(oled, 7);
+	err = send_cmd_cached(oled, &oled->state.com_dir,
+			      (flip ^ mirror_y) ? SET_COM_OUTPUT_DECR :
+						  SET_COM_OUTPUT_INCR);
 	if (err) {
-		LOG(KERN_DEBUG, "Set page address failed");
+		LOG(KERN_DEBUG, "Set scan direction failed");
 		return err;
 	}
 
+	return 0;
+}
+
+/**
+ * @brief
+ *     Find columns of the page which differ from the panel RAM mirror,
+ *     comparing 8 columns at once. Runs of changed columns separated by
+ *     less than SSD1306_WINDOW_COST unchanged columns are joined, sending
+ *     them is cheaper than another transfer.
+ *
+ * @param[IN]  oled     pointer to SSD1306 main handle
+ * @param[IN]  page     page to compare
+ * @param[OUT] runs     changed column runs
+ *
+ * @return returns number of runs
+ */
+static int ssd1306_diff_page(struct ssd1306 *oled, int page,
+			     struct ssd1306_run *runs)
+{
+	const int base = DISP_BUFF_OFFSET + page * SSD1306_HORIZONTAL_MAX;
+	const int first = round_down(oled->dirty_start[page], 8);
+	const int last = oled->dirty_end[page];
+	int col, start, end;
+	int count = 0;
+
+	for (col = first; col <= last; col += 8) {
+		const u64 diff =
+			get_unaligned_le64(&oled->disp_buff[base + col]) ^
+			get_unaligned_le64(&oled->sent_buff[base + col]);
+
+		if (!diff)
+			continue;
+
+		//Byte i of little endian word is column col + i
+		start = col + __ffs64(diff) / 8;
+		end = col + (fls64(diff) - 1) / 8;
+
+		if (count && (start - runs[count - 1].end - 1 <
+			      SSD1306_WINDOW_COST ||
+			      count == SSD1306_RUNS_MAX)) {
+			runs[count - 1].end = end;
+			continue;
+		}
+
+		runs[count].start = start;
+		runs[count].end = end;
+		count++;
+	}
+
+	return count;
+}
+
+/**
+ * @brief
+ *     Send only changed parts of the display buffer. Marked areas are
+ *     compared with the mirror of the panel RAM, so content painted again
+ *     with the same pixels is not sent. Neighbour pages with the same
+ *     single changed run are sent in one transfer.
+ *
+ * @param[IN] oled    pointer to SSD1306 main handle
+ *
+ * @return returns zero or negative error
+ */
+int ssd1306_display_dirty(struct ssd1306 *oled)
+{
+	struct ssd1306_run runs[SSD1306_PAGES][SSD1306_RUNS_MAX];
+	int count[SSD1306_PAGES];
+	int page, last, run;
+	bool changed = false;
+	int err = 0;
+
+	if (!oled)
+		return -EPERM;
+
+	//Panel RAM is unknown, the mirror can't be trusted
+	if (oled->sent_stale)
+		ssd1306_mark_dirty(oled, 0, 0, SSD1306_HORIZONTAL_MAX - 1,
+				   SSD1306_VERTICAL_MAX - 1);
+
+	for (page = 0; page < SSD1306_PAGES; page++) {
+		if (oled->sent_stale) {
+			runs[page][0].start = 0;
+			runs[page][0].end = SSD1306_HORIZONTAL_MAX - 1;
+			count[page] = 1;
+		} else if (oled->dirty_start[page] <= oled->dirty_end[page]) {
+			count[page] = ssd1306_diff_page(oled, page, runs[page]);
+		} else {
+			count[page] = 0;
+		}
+
+		changed |= count[page] != 0;
+	}
+
+	//Nothing changed, the panel already shows the buffer
+	if (!changed) {
+		ssd1306_clear_dirty(oled);
+		return 0;
+	}
+
+	ssd1306_frame_start(oled);
+
+	for (page = 0; page < SSD1306_PAGES; page = last + 1) {
+		last = page;
+
+		if (count[page] == 1) {
+			while (last + 1 < SSD1306_PAGES &&
+			       count[last + 1] == 1 &&
+			       runs[last + 1][0].start == runs[page][0].start &&
+			       runs[last + 1][0].end == runs[page][0].end)
+				last++;
+		}
+
+		for (run = 0; run < count[page]; run++) {
+			err = ssd1306_display_area(oled, runs[page][run].start,
+						   page, runs[page][run].end,
+						   last);
+			if (err)
+				goto exit;
+		}
+	}
+
+	oled->sent_stale = false;
+	ssd1306_clear_dirty(oled);
+
+exit:
+	ssd1306_frame_end(oled, err);
+
+	return err;
+}
+
+/**
+ * @brief
+ *     Send buffer content to the driver
+ *
+ * @param[IN] oled    pointer to SSD1306 main handle
+ *
+ * @return returns zero or negative error
+ */
+int ssd1306_display(struct ssd1306 *oled)
+{
+	int err;
+
+	if (!oled)
+		return -EPERM;
+
+	if (ssd1306_transposed(oled))
+		ssd1306_rotate_area(oled, 0, 0, ssd1306_width(oled) - 1,
+				    ssd1306_height(oled) - 1);
+
+	//Shifted frame does not match the RAM layout, send it by areas
+	if (oled->shift_x) {
+		oled->sent_stale = true;
+		return ssd1306_display_dirty(oled);
+	}
+
+	ssd1306_frame_start(oled);
+
+	//Window of the panel pages only, so the pointer wraps after a frame
+	err = ssd1306_set_window(oled, 0, 0, SSD1306_HORIZONTAL_MAX - 1,
+				 SSD1306_PAGES - 1);
+	if (err)
+		goto exit;
+
 	if (oled->disp_buff[0] != SET_DISP_START_LINE) {
 		LOG(KERN_DEBUG, "Display buffer contaminated");
 		oled->disp_buff[0] = SET_DISP_START_LINE;
@@ -128,14 +720,52 @@ int ssd1306_display(struct ssd1306 *oled)
 			       DISP_BUFF_SIZE);
 	if (err < 0) {
 		LOG(KERN_DEBUG, "Display refresh failure");
-		return err;
+		ssd1306_state_invalidate(oled);
+		goto exit;
 	}
 
 	if (err != DISP_BUFF_SIZE) {
 		LOG(KERN_DEBUG, "Display refreshed incompletely");
+		ssd1306_state_invalidate(oled);
+		oled->sent_stale = true;
+	} else {
+		memcpy(oled->sent_buff, oled->disp_buff, DISP_BUFF_SIZE);
+		oled->sent_stale = false;
 	}
 
-	return 0;
+	err = 0;
+	ssd1306_clear_dirty(oled);
+
+exit:
+	ssd1306_frame_end(oled, err);
+
+	return err;
+}
+
+/**
+ * @brief
+ *     Estimate how many times per second the panel scans its RAM:
+ *     Fosc / (D * K * MUX), where D is clock divide ratio, K is number of
+ *     oscillator periods per row (precharge phases + 50) and MUX is number
+ *     of multiplexed rows.
+ * @note
+ *     Oscillator frequency is a typical value, 370 kHz for the reset
+ *     setting 0x8 and roughly 20 kHz per step. Real panels differ by
+ *     several percent.
+ *
+ * @param[IN] oled    pointer to SSD1306 main handle
+ *
+ * @return returns refresh rate in Hz
+ */
+int ssd1306_refresh_rate(struct ssd1306 *oled)
+{
+	const int fosc_khz = 370 + ((oled->clock >> 4) - 8) * 20;
+	const int divide = (oled->clock & 0x0F) + 1;
+	const int row_clocks = (oled->precharge & 0x0F) +
+			       (oled->precharge >> 4) + 50;
+	const int rows = SSD1306_MLTPLX_RATIO + 1;
+
+	return fosc_khz * 1000 / (divide * row_clocks * rows);
 }
 
 /**
@@ -156,10 +786,51 @@ int ssd1306_clear_display(struct ssd1306 *oled)
 
 	//Clear all data in display buffer
 	memset(oled->disp_buff, 0x00, DISP_BUFF_SIZE);
+	if (oled->canvas != oled->disp_buff)
+		memset(oled->canvas, 0x00, DISP_BUFF_SIZE);
 
 	//Inform the driver about incoming transaction
 	oled->disp_buff[0] = SET_DISP_START_LINE;
 
+	ssd1306_mark_dirty(oled, 0, 0, SSD1306_HORIZONTAL_MAX - 1,
+			   SSD1306_VERTICAL_MAX - 1);
+
+	return 0;
+}
+
+/**
+ * @brief
+ *     Clear RAM pages below the panel height. They are never written by
+ *     frames, but the orbit start line shift shows their rows.
+ *
+ * @param[IN] oled    pointer to SSD1306 main handle
+ *
+ * @return returns zero or negative error
+ */
+static int ssd1306_clear_hidden(struct ssd1306 *oled)
+{
+	const int len = DISP_BUFF_OFFSET + SSD1306_HORIZONTAL_MAX *
+			(SSD1306_RAM_PAGES - SSD1306_PAGES);
+	int err;
+
+	if (SSD1306_PAGES == SSD1306_RAM_PAGES)
+		return 0;
+
+	err = ssd1306_set_window(oled, 0, SSD1306_PAGES,
+				 SSD1306_HORIZONTAL_MAX - 1,
+				 SSD1306_RAM_PAGES - 1);
+	if (err)
+		return err;
+
+	oled->tx_buff[0] = SET_DISP_START_LINE;
+	memset(&oled->tx_buff[DISP_BUFF_OFFSET], 0, len - DISP_BUFF_OFFSET);
+
+	err = i2c_master_send(oled->i2c_client, oled->tx_buff, len);
+	if (err != len) {
+		ssd1306_state_invalidate(oled);
+		return err < 0 ? err : -EIO;
+	}
+
 	return 0;
 }
 
@@ -176,6 +847,10 @@ int ssd1306_init_hw(struct ssd1306 *oled)
 #define INIT_FAULT "Initialization fault: %s"
 	int err;
 
+	//Nothing is known about the controller before initialization
+	ssd1306_state_invalidate(oled);
+	oled->sent_stale = true;
+
 	//Check if ssd1306 was connected to the bus
 	err = send_cmd(oled, NOP);
 	if (err) {
@@ -184,41 +859,37 @@ int ssd1306_init_hw(struct ssd1306 *oled)
 	}
 
 	//Let's perform default initialization
-	err = send_cmd(oled, SET_DISP_OFF);
+	err = ssd1306_enable_display(oled, false);
 	if (err) {
 		LOG(KERN_DEBUG, INIT_FAULT, "Set display OFF failed");
 		return err;
 	}
 
 	err = send_cmd(oled, SET_MLTPLX_RATIO);
-	err |= send_cmd(oled, 0x3F);
+	err |= send_cmd(oled, SSD1306_MLTPLX_RATIO);
 	if (err) {
 		LOG(KERN_DEBUG, INIT_FAULT, "Set multiplex ratio failed");
 		return err;
 	}
 
-	err = send_cmd(oled, SET_DISP_OFFSET);
-	err |= send_cmd(oled, 0);
+	err = ssd1306_set_offset(oled, 0);
 	if (err) {
 		LOG(KERN_DEBUG, INIT_FAULT, "Set display offset failed");
 		return err;
 	}
 
-	err = send_cmd(oled, SET_DISP_START_LINE);
+	//Keep the orbit position, the image moves down by shift_y rows
+	err = ssd1306_set_start_line(oled, (SSD1306_RAM_ROWS - oled->shift_y) %
+					   SSD1306_RAM_ROWS);
 	if (err) {
 		LOG(KERN_DEBUG, INIT_FAULT, "Set start line failed");
 		return err;
 	}
 
-	err = send_cmd(oled, SET_SEG_REMAP);
-	if (err) {
-		LOG(KERN_DEBUG, INIT_FAULT, "Set segment re-map failed");
-		return err;
-	}
-
-	err = send_cmd(oled, SET_COM_OUTPUT_INCR);
+	err = ssd1306_set_orientation(oled, oled->rotation, oled->mirror_x,
+				      oled->mirror_y);
 	if (err) {
-		LOG(KERN_DEBUG, INIT_FAULT, "Set scan direction failed");
+		LOG(KERN_DEBUG, INIT_FAULT, "Set orientation failed");
 		return err;
 	}
 
@@ -229,8 +900,7 @@ int ssd1306_init_hw(struct ssd1306 *oled)
 		return err;
 	}
 
-	err = send_cmd(oled, SET_CONTRAST_CTRL);
-	err |= send_cmd(oled, 0xFF);
+	err = ssd1306_set_contrast(oled, oled->contrast);
 	if (err) {
 		LOG(KERN_DEBUG, INIT_FAULT, "Set contrast control failed");
 		return err;
@@ -242,23 +912,28 @@ int ssd1306_init_hw(struct ssd1306 *oled)
 		return err;
 	}
 
-	err = send_cmd(oled, SET_DISP_CLOCK_DEV);
-	err |= send_cmd(oled, 0x80);
+	err = ssd1306_set_timing(oled, oled->clock, oled->precharge,
+				 oled->vcomh);
 	if (err) {
-		LOG(KERN_DEBUG, INIT_FAULT, "Set display clock divider failed");
+		LOG(KERN_DEBUG, INIT_FAULT, "Set display timing failed");
 		return err;
 	}
 
-	err = send_cmd(oled, ENABLE_CHARGE_PUMP_REG);
-	err |= send_cmd(oled, ENABLE_CHARGE_PUMP);
+	err = ssd1306_enable_charge_pump(oled, true);
 	if (err) {
 		LOG(KERN_DEBUG, INIT_FAULT, "Enable charge pump failed");
 		return err;
 	}
 
+	err = ssd1306_clear_hidden(oled);
+	if (err) {
+		LOG(KERN_DEBUG, INIT_FAULT, "Clear hidden RAM failed");
+		return err;
+	}
+
 	LOG(KERN_DEBUG, "Driver display initialize done");
 
-	send_cmd(oled, SET_DISP_ON);
+	err = ssd1306_enable_display(oled, true);
 	if (err)
 		LOG(KERN_DEBUG, INIT_FAULT, "Set display ON failed");
 
@@ -276,10 +951,10 @@ void ssd1306_deinit_hw(struct ssd1306 *oled)
 {
 	int err;
 
-	//Clear display area
-	memset(&oled->disp_buff[1], 0x00, DISP_BUFF_SIZE - 1);
-
-	err = ssd1306_display(oled);
+	//Clear the canvas too, transposed one is rotated over the display area
+	err = ssd1306_clear_display(oled);
+	if (!err)
+		err = ssd1306_display(oled);
 	if (err)
 		LOG(KERN_DEBUG, "Display clear failure");
 
@@ -304,18 +979,13 @@ void ssd1306_deinit_hw(struct ssd1306 *oled)
  */
 int ssd1306_enable_charge_pump(struct ssd1306* oled, bool enable)
 {
-	int err;
-
 	if (IS_ERR_OR_NULL(oled))
 		return -EPERM;
 
-	err = send_cmd(oled, ENABLE_CHARGE_PUMP_REG);
-	if (enable)
-		err |= send_cmd(oled, ENABLE_CHARGE_PUMP);
-	else
-		err |= send_cmd(oled, DISABLE_CHARGE_PUMP);
-
-	return err;
+	return send_cmd_arg_cached(oled, &oled->state.charge_pump,
+				   ENABLE_CHARGE_PUMP_REG,
+				   enable ? ENABLE_CHARGE_PUMP :
+					    DISABLE_CHARGE_PUMP);
 }
 
 /**
@@ -332,8 +1002,113 @@ int ssd1306_enable_display(struct ssd1306* oled, bool enable)
 	if (IS_ERR_OR_NULL(oled))
 		return -EPERM;
 
-	if (enable)
-		return send_cmd(oled, SET_DISP_ON);
+	return send_cmd_cached(oled, &oled->state.disp_on,
+			       enable ? SET_DISP_ON : SET_DISP_OFF);
+}
 
-	return send_cmd(oled, SET_DISP_OFF);
+/**
+ * @brief
+ *     Set contrast control, 256 steps of segment current
+ *
+ * @param[IN] oled        pointer to SSD1306 main handle
+ * @param[IN] contrast    contrast value
+ *
+ * @return returns zero or negative error
+ */
+int ssd1306_set_contrast(struct ssd1306 *oled, uint8_t contrast)
+{
+	return send_cmd_arg_cached(oled, &oled->state.contrast,
+				   SET_CONTRAST_CTRL, contrast);
+}
+
+/**
+ * @brief
+ *     Show RAM content normally or inverted
+ *
+ * @param[IN] oled      pointer to SSD1306 main handle
+ * @param[IN] invert    lit pixels for cleared bits
+ *
+ * @return returns zero or negative error
+ */
+int ssd1306_set_invert(struct ssd1306 *oled, bool invert)
+{
+	return send_cmd_cached(oled, &oled->state.invert,
+			       invert ? SET_DISP_INVERT : SET_DISP_NORMAL);
+}
+
+/**
+ * @brief
+ *     Set RAM row shown on the first panel row
+ *
+ * @param[IN] oled    pointer to SSD1306 main handle
+ * @param[IN] line    RAM row, 0 to 63
+ *
+ * @return returns zero or negative error
+ */
+int ssd1306_set_start_line(struct ssd1306 *oled, int line)
+{
+	if (line < 0 || line > 63)
+		return -EINVAL;
+
+	return send_cmd_cached(oled, &oled->state.start_line,
+			       SET_DISP_START_LINE | line);
+}
+
+/**
+ * @brief
+ *     Set vertical shift of COM outputs
+ *
+ * @param[IN] oled      pointer to SSD1306 main handle
+ * @param[IN] offset    shift in rows, 0 to 63
+ *
+ * @return returns zero or negative error
+ */
+int ssd1306_set_offset(struct ssd1306 *oled, int offset)
+{
+	if (offset < 0 || offset > 63)
+		return -EINVAL;
+
+	return send_cmd_arg_cached(oled, &oled->state.offset,
+				   SET_DISP_OFFSET, offset);
+}
+
+/**
+ * @brief
+ *     Set panel timing: display clock, precharge period and VCOMH deselect
+ *     level. Panel refresh rate follows the clock and the precharge.
+ * @note
+ *     Caller has to hold oled->lock
+ *
+ * @param[IN] oled         pointer to SSD1306 main handle
+ * @param[IN] clock        divide ratio - 1 (bits 3:0), oscillator
+ *                         frequency (bits 7:4)
+ * @param[IN] precharge    phase 1 (bits 3:0) and phase 2 (bits 7:4) in
+ *                         DCLKs, 1 to 15 each
+ * @param[IN] vcomh        VCOMH level (bits 6:4), 0x00, 0x20 or 0x30 are
+ *                         documented
+ *
+ * @return returns zero or negative error
+ */
+int ssd1306_set_timing(struct ssd1306 *oled, uint8_t clock, uint8_t precharge,
+		       uint8_t vcomh)
+{
+	int err;
+
+	if (!(precharge & 0x0F) || !(precharge & 0xF0) || (vcomh & ~0x70))
+		return -EINVAL;
+
+	oled->clock = clock;
+	oled->precharge = precharge;
+	oled->vcomh = vcomh;
+
+	err = send_cmd_arg_cached(oled, &oled->state.clock, SET_DISP_CLOCK_DEV,
+				  clock);
+	if (!err)
+		err = send_cmd_arg_cached(oled, &oled->state.precharge,
+					  SET_PRECHARGE_PERIOD, precharge);
+	if (!err)
+		err = send_cmd_arg_cached(oled, &oled->state.vcomh,
+					  SET_VCOMH_DESELECT_LVL, vcomh);
+
+	return err;
 }
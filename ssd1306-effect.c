@@ -0,0 +1,346 @@
+// SPDX-License-Identifier: (GPL-2.0 OR MIT)
+
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/hrtimer.h>
+#include <linux/workqueue.h>
+
+#include "ssd1306.h"
+#include "ssd1306-ioctl.h"
+#include "ssd1306-effect.h"
+
+/**
+ * Contrast fades and blinking need no frame data. Every step sends a single
+ * command with at most one argument, repeated values are skipped by the
+ * controller state cache. Steps are timed by hrtimer and sent from work,
+ * because the bus may sleep.
+ */
+
+/**
+ * @brief
+ *     Map linear progress of the fade to eased one
+ *
+ * @param[IN] easing    enum ssd1306_easing
+ * @param[IN] p         progress 0..SSD1306_EASE_ONE
+ *
+ * @return returns eased progress 0..SSD1306_EASE_ONE
+ */
+static int ssd1306_effect_ease(int easing, int p)
+{
+	switch (easing) {
+	case SSD1306_EASE_IN:
+		return p * p / SSD1306_EASE_ONE;
+	case SSD1306_EASE_OUT:
+		return p * (2 * SSD1306_EASE_ONE - p) / SSD1306_EASE_ONE;
+	case SSD1306_EASE_IN_OUT:
+		if (p < SSD1306_EASE_ONE / 2)
+			return 2 * p * p / SSD1306_EASE_ONE;
+		p = SSD1306_EASE_ONE - p;
+		return SSD1306_EASE_ONE - 2 * p * p / SSD1306_EASE_ONE;
+	default:
+		return p;
+	}
+}
+
+/**
+ * @brief
+ *     Send one step of the effect, clear running after the last one
+ * @note
+ *     Caller has to hold oled->lock
+ *
+ * @return returns zero or negative error
+ */
+static int ssd1306_effect_step(struct ssd1306_effects *fx)
+{
+	struct ssd1306 *oled = fx->oled;
+	s64 elapsed;
+	int p;
+
+	if (fx->type == SSD1306_EFFECT_FADE) {
+		elapsed = ktime_ms_delta(ktime_get(), fx->start);
+		if (elapsed >= fx->duration) {
+			fx->running = false;
+			return ssd1306_set_contrast(oled, fx->to);
+		}
+
+		p = ssd1306_effect_ease(fx->easing, (int)elapsed *
+					SSD1306_EASE_ONE / fx->duration);
+
+		return ssd1306_set_contrast(oled, fx->from +
+					    (fx->to - fx->from) * p /
+					    SSD1306_EASE_ONE);
+	}
+
+	//Blink toggles the display, invert and flash toggle the colors
+	fx->on = !fx->on;
+	if (fx->toggles && !--fx->toggles)
+		fx->running = false;
+
+	if (fx->type == SSD1306_EFFECT_BLINK)
+		return ssd1306_enable_display(oled, !fx->on);
+
+	return ssd1306_set_invert(oled, fx->on);
+}
+
+/**
+ * @brief
+ *     Return the panel to the state without effect
+ * @note
+ *     Caller has to hold oled->lock
+ *
+ * @return returns zero or negative error
+ */
+static int ssd1306_effect_restore(struct ssd1306 *oled)
+{
+	int err;
+
+	err = ssd1306_set_contrast(oled, oled->contrast);
+	if (!err)
+		err = ssd1306_set_invert(oled, false);
+	if (!err)
+		err = ssd1306_enable_display(oled, true);
+
+	return err;
+}
+
+/**
+ * @brief
+ *     Stop the steps and wait for the one being sent
+ * @note
+ *     Caller has to hold fx->lock, but not oled->lock
+ */
+static void ssd1306_effect_halt(struct ssd1306_effects *fx)
+{
+	mutex_lock(&fx->oled->lock);
+	fx->running = false;
+	mutex_unlock(&fx->oled->lock);
+
+	hrtimer_cancel(&fx->timer);
+	cancel_work_sync(&fx->work);
+}
+
+static enum hrtimer_restart ssd1306_effect_tick(struct hrtimer *timer)
+{
+	struct ssd1306_effects *fx = container_of(timer, struct ssd1306_effects,
+						  timer);
+
+	if (!READ_ONCE(fx->running))
+		return HRTIMER_NORESTART;
+
+	queue_work(system_highpri_wq, &fx->work);
+	hrtimer_forward_now(timer, fx->period);
+
+	return HRTIMER_RESTART;
+}
+
+static void ssd1306_effect_work(struct work_struct *work)
+{
+	struct ssd1306_effects *fx = container_of(work, struct ssd1306_effects,
+						  work);
+	struct ssd1306 *oled = fx->oled;
+	int err;
+
+	mutex_lock(&oled->lock);
+
+	if (fx->running) {
+		err = ssd1306_effect_step(fx);
+		if (err)
+			LOG(KERN_DEBUG, "Effect step failed: %d", err);
+	}
+
+	mutex_unlock(&oled->lock);
+}
+
+/**
+ * @brief
+ *     Replace running effect by a new one. The first step is sent before
+ *     returning. SSD1306_EFFECT_NONE stops the effect.
+ *
+ * @param[IN] oled      pointer to SSD1306 main handle
+ * @param[IN] effect    effect parameters
+ *
+ * @return returns zero or negative error
+ */
+int ssd1306_effect_start(struct ssd1306 *oled,
+			 const struct ssd1306_effect *effect)
+{
+	struct ssd1306_effects *fx = oled->effects;
+	unsigned int step_ms;
+	bool running;
+	int err;
+
+	if (effect->type > SSD1306_EFFECT_FLASH ||
+	    effect->easing > SSD1306_EASE_IN_OUT ||
+	    effect->duration_ms > SSD1306_EFFECT_PERIOD_MAX ||
+	    effect->period_ms > SSD1306_EFFECT_PERIOD_MAX ||
+	    effect->count > UINT_MAX / 2)
+		return -EINVAL;
+
+	switch (effect->type) {
+	case SSD1306_EFFECT_NONE:
+		return ssd1306_effect_stop(oled);
+	case SSD1306_EFFECT_FADE:
+		step_ms = effect->period_ms ? : SSD1306_EFFECT_STEP_MS;
+		break;
+	case SSD1306_EFFECT_FLASH:
+		step_ms = effect->duration_ms;
+		break;
+	default:
+		//Blink period consists of two toggles
+		step_ms = effect->period_ms / 2;
+		break;
+	}
+
+	if (!step_ms)
+		return -EINVAL;
+
+	mutex_lock(&fx->lock);
+
+	ssd1306_effect_halt(fx);
+
+	mutex_lock(&oled->lock);
+
+	err = ssd1306_effect_restore(oled);
+	if (err)
+		goto unlock;
+
+	fx->type = effect->type;
+	fx->easing = effect->easing;
+	fx->from = effect->from;
+	fx->to = effect->to;
+	fx->duration = effect->duration_ms;
+	fx->period = ms_to_ktime(step_ms);
+	fx->toggles = effect->count * 2;
+	fx->on = false;
+
+	//Contrast the fade ends at stays when it is stopped
+	if (effect->type == SSD1306_EFFECT_FADE)
+		oled->contrast = effect->to;
+	else if (effect->type == SSD1306_EFFECT_FLASH)
+		fx->toggles = 2;
+
+	fx->running = true;
+	fx->start = ktime_get();
+
+	err = ssd1306_effect_step(fx);
+	if (err)
+		fx->running = false;
+
+unlock:
+	running = fx->running;
+	mutex_unlock(&oled->lock);
+
+	if (running)
+		hrtimer_start(&fx->timer, fx->period, HRTIMER_MODE_REL);
+
+	mutex_unlock(&fx->lock);
+
+	return err;
+}
+
+/**
+ * @brief
+ *     Stop running effect and restore contrast, normal colors and display on
+ *
+ * @param[IN] oled    pointer to SSD1306 main handle
+ *
+ * @return returns zero or negative error
+ */
+int ssd1306_effect_stop(struct ssd1306 *oled)
+{
+	struct ssd1306_effects *fx = oled->effects;
+	int err;
+
+	mutex_lock(&fx->lock);
+
+	ssd1306_effect_halt(fx);
+
+	mutex_lock(&oled->lock);
+	fx->type = SSD1306_EFFECT_NONE;
+	err = ssd1306_effect_restore(oled);
+	mutex_unlock(&oled->lock);
+
+	mutex_unlock(&fx->lock);
+
+	return err;
+}
+
+/**
+ * @brief
+ *     Set contrast shown without effect. Running fade is stopped, blinking
+ *     goes on with the new contrast.
+ *
+ * @param[IN] oled        pointer to SSD1306 main handle
+ * @param[IN] contrast    contrast value
+ *
+ * @return returns zero or negative error
+ */
+int ssd1306_effect_contrast(struct ssd1306 *oled, uint8_t contrast)
+{
+	struct ssd1306_effects *fx = oled->effects;
+	bool fade;
+	int err;
+
+	mutex_lock(&fx->lock);
+
+	mutex_lock(&oled->lock);
+	fade = fx->running && fx->type == SSD1306_EFFECT_FADE;
+	mutex_unlock(&oled->lock);
+
+	if (fade)
+		ssd1306_effect_halt(fx);
+
+	mutex_lock(&oled->lock);
+	oled->contrast = contrast;
+	err = ssd1306_set_contrast(oled, contrast);
+	mutex_unlock(&oled->lock);
+
+	mutex_unlock(&fx->lock);
+
+	return err;
+}
+
+/**
+ * @brief
+ *     Allocate stopped effect engine of the display
+ *
+ * @param[IN] oled    pointer to SSD1306 main handle
+ *
+ * @return returns zero or negative error
+ */
+int ssd1306_effect_init(struct ssd1306 *oled)
+{
+	struct ssd1306_effects *fx;
+
+	fx = kzalloc(sizeof(*fx), GFP_KERNEL);
+	if (!fx)
+		return -ENOMEM;
+
+	fx->oled = oled;
+	mutex_init(&fx->lock);
+	INIT_WORK(&fx->work, ssd1306_effect_work);
+	hrtimer_init(&fx->timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	fx->timer.function = ssd1306_effect_tick;
+	oled->effects = fx;
+
+	return 0;
+}
+
+/**
+ * @brief
+ *     Stop the effect engine and free it. Panel state is left as it is.
+ *
+ * @param[IN] oled    pointer to SSD1306 main handle
+ */
+void ssd1306_effect_exit(struct ssd1306 *oled)
+{
+	if (!oled->effects)
+		return;
+
+	mutex_lock(&oled->effects->lock);
+	ssd1306_effect_halt(oled->effects);
+	mutex_unlock(&oled->effects->lock);
+
+	kfree(oled->effects);
+	oled->effects = NULL;
+}
@@ -0,0 +1,33 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+
+//Fade step when the period is not given, 50 contrast commands per second
+#define SSD1306_EFFECT_STEP_MS     20
+#define SSD1306_EFFECT_PERIOD_MAX  60000
+//Fixed point of the fade progress
+#define SSD1306_EASE_ONE           1024
+
+struct ssd1306_effect;
+
+struct ssd1306_effects {
+	struct ssd1306 *oled;
+	struct hrtimer timer;      /*! Step cadence */
+	struct work_struct work;   /*! Sends one step */
+	struct mutex lock;         /*! Serializes effect start and stop */
+	bool running;              /*! Cleared under oled->lock to stop steps */
+	int type;                  /*! enum ssd1306_effect_type */
+	int easing;                /*! enum ssd1306_easing */
+	uint8_t from;              /*! Fade start contrast */
+	uint8_t to;                /*! Fade end contrast */
+	ktime_t start;             /*! When the effect started */
+	unsigned int duration;     /*! Length of the fade in milliseconds */
+	ktime_t period;            /*! Time between steps */
+	unsigned int toggles;      /*! Toggles left, 0 runs until stopped */
+	bool on;                   /*! Blink or invert phase is active */
+};
+
+int ssd1306_effect_init(struct ssd1306 *oled);
+void ssd1306_effect_exit(struct ssd1306 *oled);
+int ssd1306_effect_start(struct ssd1306 *oled,
+			 const struct ssd1306_effect *effect);
+int ssd1306_effect_stop(struct ssd1306 *oled);
+int ssd1306_effect_contrast(struct ssd1306 *oled, uint8_t contrast);
@@ -1,11 +1,16 @@
 // SPDX-License-Identifier: (GPL-2.0 OR MIT)
 
 #include <linux/font.h>
+#include <linux/init.h>
+#include <linux/bits.h>
 #include <linux/slab.h>
 
 #include "ssd1306.h"
 #include "ssd1306-font.h"
 
+//Page byte with every bit repeated 2, 3 and 4 times
+static u32 ssd1306_spread[SSD1306_FONT_SCALE_MAX - 1][256];
+
 /**
  * @brief
  *     Draw single ASCII character using default kernel font
@@ -18,13 +23,83 @@
  * @return returns zero or negative error
  */
 int ssd1306_print_char(struct ssd1306 *oled, int x, int y, char c)
+{
+	if (!oled)
+		return -EPERM;
+
+	return ssd1306_print_char_buff(oled, oled->canvas, x, y, c);
+}
+
+/**
+ * @brief
+ *     Draw single ASCII character into any buffer laid out like the canvas
+ *
+ * @param[IN] oled    pointer to SSD1306 main handle
+ * @param[IN] buff    pointer to the page buffer
+ * @param[IN] x       start of horizontal coordinate
+ * @param[IN] y       start of vertical coordinate
+ * @param[IN] c       ASCII character
+ *
+ * @return returns zero or negative error
+ */
+int ssd1306_print_char_buff(struct ssd1306 *oled, uint8_t *buff, int x, int y,
+			    char c)
+{
+	return ssd1306_print_char_scaled_buff(oled, buff, x, y, c, 1, 1);
+}
+
+/**
+ * @brief
+ *     Fill bit-spread tables: entry of a page byte holds every bit
+ *     repeated scale times, bit r of the byte becomes bits r * scale to
+ *     r * scale + scale - 1.
+ */
+void __init ssd1306_font_init(void)
+{
+	int scale, value, bit;
+
+	for (scale = 2; scale <= SSD1306_FONT_SCALE_MAX; scale++) {
+		for (value = 0; value < 256; value++) {
+			u32 spread = 0;
+
+			for (bit = 0; bit < 8; bit++)
+				if (value & BIT(bit))
+					spread |= GENMASK(scale - 1, 0) <<
+						  (bit * scale);
+
+			ssd1306_spread[scale - 2][value] = spread;
+		}
+	}
+}
+
+/**
+ * @brief
+ *     Draw single ASCII character scaled by integer factors. The glyph is
+ *     transposed to page format once, then every glyph column is expanded
+ *     to its scaled page bytes with a single table lookup and repeated
+ *     scale_x times. Glyph pixels are set, background is kept.
+ *
+ * @param[IN] oled       pointer to SSD1306 main handle
+ * @param[IN] buff       pointer to the page buffer
+ * @param[IN] x          start of horizontal coordinate
+ * @param[IN] y          start of vertical coordinate
+ * @param[IN] c          ASCII character
+ * @param[IN] scale_x    horizontal scale, 1 to SSD1306_FONT_SCALE_MAX
+ * @param[IN] scale_y    vertical scale, 1 to SSD1306_FONT_SCALE_MAX
+ *
+ * @return returns zero or negative error
+ */
+int ssd1306_print_char_scaled_buff(struct ssd1306 *oled, uint8_t *buff, int x,
+				   int y, char c, int scale_x, int scale_y)
 {
 	const struct font_desc *font = NULL;
-	int line_x, line_y;
-	uint8_t vline;
-	uint8_t *ptr;
+	const int offset = DISP_BUFF_OFFSET;
+	const uint8_t *ptr;
+	u64 glyph = 0;
+	int row, col, i, page;
+	int width, pages;
 
-	if (!oled)
+	if (!oled || !buff)
 		return -EPERM;
 
 	if ( x < 0 || y < 0) {
@@ -32,18 +107,25 @@ int ssd1306_print_char(struct ssd1306 *oled, int x, int y, char c)
 		return -EPERM;
 	}
 
-	if (x >= SSD1306_HORIZONTAL_MAX) {
+	if (x >= ssd1306_width(oled)) {
 		LOG(KERN_DEBUG, "Coordinate x has to be smaller then %d",
-		    SSD1306_HORIZONTAL_MAX);
+		    ssd1306_width(oled));
 		return -EPERM;
 	}
 
-	if (y >= SSD1306_VERTICAL_MAX) {
+	if (y >= ssd1306_height(oled)) {
 		LOG(KERN_DEBUG, "Coordinate y has to be smaller then %d",
-		    SSD1306_VERTICAL_MAX);
+		    ssd1306_height(oled));
 		return -EPERM;
 	}
 
+	if (scale_x < 1 || scale_x > SSD1306_FONT_SCALE_MAX ||
+	    scale_y < 1 || scale_y > SSD1306_FONT_SCALE_MAX)
+		return -EINVAL;
+
+	width = ssd1306_width(oled);
+	pages = ssd1306_height(oled) / SSD1306_CELL_CAPACITY;
+
 	/* TODO: Get default character for now. Give user possibility
 	 *       to choose in future
 	 */
@@ -55,24 +137,36 @@ int ssd1306_print_char(struct ssd1306 *oled, int x, int y, char c)
 		return -EPERM;
 	}
 
-	LOG(KERN_DEBUG, "Default font name: %s, Character: %c,"
-	    " Array position: %d", font->name, c, (c * DEFAULT_FONT_HEIGHT));
-
 	/* Start address of given character in font array
 	 * TODO: Remember to change DEFAULT_FONT_HEIGHT to the font height
 	 *       when the font selection option is provided
 	 */
-	ptr = (uint8_t *) font->data + (c * DEFAULT_FONT_HEIGHT);
+	ptr = (uint8_t *) font->data + ((uint8_t)c * DEFAULT_FONT_HEIGHT);
 
-	for (line_y=0; line_y<DEFAULT_FONT_HEIGHT; line_y++)
-	{
-		memcpy(&vline, (ptr + line_y), sizeof(vline));
+	//Byte 7 - col of transposed glyph is column col in page format
+	for (row = 0; row < DEFAULT_FONT_HEIGHT; row++)
+		glyph |= (u64)ptr[row] << (8 * row);
+	glyph = ssd1306_transpose8(glyph);
+
+	for (col = 0; col < DEFAULT_FONT_WIDTH; col++) {
+		const uint8_t column = glyph >> (8 * (7 - col));
+		const int col_x = x + col * scale_x;
+		u64 pxls;
+
+		if (!column)
+			continue;
+
+		pxls = scale_y == 1 ? column :
+		       ssd1306_spread[scale_y - 2][column];
+		pxls <<= y % SSD1306_CELL_CAPACITY;
 
-		for (line_x = 0; line_x < DEFAULT_FONT_WIDTH; line_x++) {
-			if (vline & 0x80)
-				/* Ignore errors, out of margin it's allowed*/
-				ssd1306_draw_pxl(oled, x + line_x, y + line_y);
-			vline <<= 1;
+		/* Out of margin it's allowed, clip to the buffer */
+		for (page = y / SSD1306_CELL_CAPACITY; pxls && page < pages;
+		     page++, pxls >>= 8) {
+			uint8_t *dst = &buff[offset + page * width];
+
+			for (i = 0; i < scale_x && col_x + i < width; i++)
+				dst[col_x + i] |= (uint8_t)pxls;
 		}
 	}
 
@@ -91,6 +185,49 @@ int ssd1306_print_char(struct ssd1306 *oled, int x, int y, char c)
  * @return returns zero or negative error
  */
 int ssd1306_print_str(struct ssd1306 *oled, int x, int y, const char* str)
+{
+	if (!oled)
+		return -EPERM;
+
+	return ssd1306_print_str_buff(oled, oled->canvas, x, y, str);
+}
+
+/**
+ * @brief
+ *     Prints an ASCII string into any buffer laid out like the canvas
+ *
+ * @param[IN] oled    pointer to SSD1306 main handle
+ * @param[IN] buff    pointer to the page buffer
+ * @param[IN] x       start of horizontal coordinate
+ * @param[IN] y       start of vertical coordinate
+ * @param[IN] str     ASCII string
+ *
+ * @return returns zero or negative error
+ */
+int ssd1306_print_str_buff(struct ssd1306 *oled, uint8_t *buff, int x, int y,
+			   const char* str)
+{
+	return ssd1306_print_str_scaled_buff(oled, buff, x, y, str, 1, 1);
+}
+
+/**
+ * @brief
+ *     Prints an ASCII string scaled by integer factors into any buffer laid
+ *     out like the canvas. Space between characters is scaled as well.
+ *
+ * @param[IN] oled       pointer to SSD1306 main handle
+ * @param[IN] buff       pointer to the page buffer
+ * @param[IN] x          start of horizontal coordinate
+ * @param[IN] y          start of vertical coordinate
+ * @param[IN] str        ASCII string
+ * @param[IN] scale_x    horizontal scale, 1 to SSD1306_FONT_SCALE_MAX
+ * @param[IN] scale_y    vertical scale, 1 to SSD1306_FONT_SCALE_MAX
+ *
+ * @return returns zero or negative error
+ */
+int ssd1306_print_str_scaled_buff(struct ssd1306 *oled, uint8_t *buff, int x,
+				  int y, const char* str, int scale_x,
+				  int scale_y)
 {
 	int err = 0;
 	int str_len;
@@ -100,7 +237,7 @@ int ssd1306_print_str(struct ssd1306 *oled, int x, int y, const char* str)
 	int avaible_space;
 	int char_num;
 
-	if (!oled || !str)
+	if (!oled || !buff || !str)
 		return -EPERM;
 
 	font = get_default_font(SSD1306_HORIZONTAL_MAX, SSD1306_VERTICAL_MAX,
@@ -111,23 +248,23 @@ int ssd1306_print_str(struct ssd1306 *oled, int x, int y, const char* str)
 		return -EPERM;
 	}
 
-	font_height = font->height;
-	font_width = font->width;
+	font_height = font->height * scale_y;
+	font_width = font->width * scale_x;
 	str_len = strlen(str);
 
 	//The total space in single line from first character to the end of line
-	avaible_space = SSD1306_HORIZONTAL_MAX - x;
+	avaible_space = ssd1306_width(oled) - x;
 
-	if (y + font_height > SSD1306_VERTICAL_MAX) {
+	if (y + font_height > ssd1306_height(oled)) {
 		LOG(KERN_DEBUG, "No more space on the display."
 		    " Move the string a little higher");
 		return -EPERM;
 	}
 
-	/* Add +1 to font_width to provide one extra pixel free space beetwen
+	/* Add one scaled pixel to font_width to provide free space beetwen
 	 * characters
 	 */
-	total_char_width = font_width + 1;
+	total_char_width = font_width + scale_x;
 	// Check if possible to entire whole string to the display
 	if (avaible_space < total_char_width * str_len) {
 		LOG(KERN_DEBUG, "ASCII string %s is too long: %d pixels "
@@ -142,7 +279,9 @@ int ssd1306_print_str(struct ssd1306 *oled, int x, int y, const char* str)
 		const int offset = char_num * total_char_width;
 
 		//Try to print entire string
-		err |= ssd1306_print_char(oled, x + offset, y, str[char_num]);
+		err |= ssd1306_print_char_scaled_buff(oled, buff, x + offset, y,
+						      str[char_num], scale_x,
+						      scale_y);
 	}
 
 	return err;
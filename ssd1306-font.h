@@ -4,5 +4,17 @@
 #define DEFAULT_FONT_WIDTH    8
 #define DEFAULT_FONT_HEIGHT   8
 
+#define SSD1306_FONT_SCALE_MAX    4
+
 int ssd1306_print_char(struct ssd1306 *oled, int x, int y, char c);
 int ssd1306_print_str(struct ssd1306 *oled, int x, int y, const char* str);
+int ssd1306_print_char_buff(struct ssd1306 *oled, uint8_t *buff, int x, int y,
+			    char c);
+int ssd1306_print_str_buff(struct ssd1306 *oled, uint8_t *buff, int x, int y,
+			   const char* str);
+int ssd1306_print_char_scaled_buff(struct ssd1306 *oled, uint8_t *buff, int x,
+				   int y, char c, int scale_x, int scale_y);
+int ssd1306_print_str_scaled_buff(struct ssd1306 *oled, uint8_t *buff, int x,
+				  int y, const char* str, int scale_x,
+				  int scale_y);
+void ssd1306_font_init(void);
@@ -0,0 +1,269 @@
+// SPDX-License-Identifier: (GPL-2.0 OR MIT)
+
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/hrtimer.h>
+#include <linux/workqueue.h>
+
+#include "ssd1306.h"
+#include "ssd1306-cmode.h"
+#include "ssd1306-layer.h"
+#include "ssd1306-gray.h"
+
+/**
+ * Gray levels are shown with temporal dithering. Frame of N = 2^bpp - 1
+ * sub-frames is repeated in a loop, pixel with level v is lit in v of them.
+ * Lit sub-frames are spread evenly over the cycle to reduce flicker.
+ */
+
+static enum hrtimer_restart ssd1306_gray_tick(struct hrtimer *timer)
+{
+	struct ssd1306_gray *gray = container_of(timer, struct ssd1306_gray,
+						 timer);
+
+	if (work_pending(&gray->work))
+		gray->overruns++;
+	else {
+		gray->fired = hrtimer_get_expires(timer);
+		queue_work(system_highpri_wq, &gray->work);
+	}
+
+	hrtimer_forward_now(timer, gray->period);
+
+	return HRTIMER_RESTART;
+}
+
+/**
+ * @brief
+ *     Send next sub-frame. Only pages different from the previous
+ *     sub-frame are marked and sent.
+ */
+static void ssd1306_gray_work(struct work_struct *work)
+{
+	struct ssd1306_gray *gray = container_of(work, struct ssd1306_gray,
+						 work);
+	struct ssd1306 *oled = gray->oled;
+	const uint8_t *plane;
+	s64 jitter;
+	int page;
+
+	jitter = ktime_to_ns(ktime_sub(ktime_get(), gray->fired));
+
+	mutex_lock(&oled->lock);
+
+	plane = &gray->front[gray->plane * SSD1306_PLANE_SIZE];
+
+	for (page = 0; page < SSD1306_PAGES; page++) {
+		const int base = page * SSD1306_HORIZONTAL_MAX;
+		uint8_t *disp = &oled->disp_buff[DISP_BUFF_OFFSET + base];
+
+		if (!memcmp(disp, &plane[base], SSD1306_HORIZONTAL_MAX))
+			continue;
+
+		memcpy(disp, &plane[base], SSD1306_HORIZONTAL_MAX);
+		ssd1306_mark_dirty(oled, 0, page * SSD1306_CELL_CAPACITY,
+				   SSD1306_HORIZONTAL_MAX - 1,
+				   page * SSD1306_CELL_CAPACITY);
+	}
+
+	ssd1306_display_dirty(oled);
+
+	gray->plane = (gray->plane + 1) % gray->planes;
+	gray->subframes++;
+	gray->jitter_sum_ns += jitter;
+	gray->jitter_max_ns = max(gray->jitter_max_ns, jitter);
+
+	mutex_unlock(&oled->lock);
+}
+
+/**
+ * @brief
+ *     Start grayscale mode. The engine owns the whole panel until it is
+ *     disabled, the screen starts black.
+ * @note
+ *     Caller has to hold oled->gray_lock, but not oled->lock
+ *
+ * @param[IN] oled       pointer to SSD1306 main handle
+ * @param[IN] bpp        bits per pixel, 2 or 4
+ * @param[IN] rate_hz    sub-frames per second, zero for panel refresh rate
+ *
+ * @return returns zero or negative error
+ */
+int ssd1306_gray_enable(struct ssd1306 *oled, int bpp, int rate_hz)
+{
+	struct ssd1306_gray *gray;
+	int level, k;
+
+	if (bpp != 2 && bpp != 4)
+		return -EINVAL;
+
+	if (rate_hz < 0 || rate_hz > 1000)
+		return -EINVAL;
+
+	if (!rate_hz)
+		rate_hz = ssd1306_refresh_rate(oled);
+
+	ssd1306_gray_disable(oled);
+
+	gray = kzalloc(sizeof(*gray), GFP_KERNEL);
+	if (!gray)
+		return -ENOMEM;
+
+	gray->oled = oled;
+	gray->bpp = bpp;
+	gray->planes = (1 << bpp) - 1;
+	gray->period = ns_to_ktime(NSEC_PER_SEC / rate_hz);
+	gray->front = kcalloc(gray->planes, SSD1306_PLANE_SIZE, GFP_KERNEL);
+	gray->back = kcalloc(gray->planes, SSD1306_PLANE_SIZE, GFP_KERNEL);
+	if (!gray->front || !gray->back) {
+		kfree(gray->front);
+		kfree(gray->back);
+		kfree(gray);
+		return -ENOMEM;
+	}
+
+	for (level = 0; level <= gray->planes; level++)
+		for (k = 0; k < gray->planes; k++)
+			if ((k + 1) * level / gray->planes !=
+			    k * level / gray->planes)
+				gray->spread[level] |= 1 << k;
+
+	INIT_WORK(&gray->work, ssd1306_gray_work);
+	hrtimer_init(&gray->timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	gray->timer.function = ssd1306_gray_tick;
+
+	mutex_lock(&oled->lock);
+	oled->gray = gray;
+	mutex_unlock(&oled->lock);
+
+	hrtimer_start(&gray->timer, gray->period, HRTIMER_MODE_REL);
+
+	LOG(KERN_DEBUG, "Grayscale %d bpp, %d sub-frames per second", bpp,
+	    rate_hz);
+
+	return 0;
+}
+
+/**
+ * @brief
+ *     Stop grayscale mode and show composed layers again
+ * @note
+ *     Caller has to hold oled->gray_lock, but not oled->lock
+ *
+ * @param[IN] oled    pointer to SSD1306 main handle
+ */
+void ssd1306_gray_disable(struct ssd1306 *oled)
+{
+	struct ssd1306_gray *gray = oled->gray;
+
+	if (!gray)
+		return;
+
+	hrtimer_cancel(&gray->timer);
+	cancel_work_sync(&gray->work);
+
+	mutex_lock(&oled->lock);
+	oled->gray = NULL;
+	ssd1306_compose(oled, 0, 0, ssd1306_width(oled) - 1,
+			ssd1306_height(oled) - 1);
+	ssd1306_display_dirty(oled);
+	mutex_unlock(&oled->lock);
+
+	LOG(KERN_DEBUG, "Grayscale sent %llu sub-frames, %llu overruns",
+	    gray->subframes, gray->overruns);
+
+	kfree(gray->front);
+	kfree(gray->back);
+	kfree(gray);
+}
+
+/**
+ * @brief
+ *     Stop sending sub-frames for system sleep, grayscale mode and its
+ *     frames are kept
+ * @note
+ *     Caller has to hold oled->gray_lock, but not oled->lock
+ *
+ * @param[IN] oled    pointer to SSD1306 main handle
+ */
+void ssd1306_gray_suspend(struct ssd1306 *oled)
+{
+	struct ssd1306_gray *gray = oled->gray;
+
+	if (!gray)
+		return;
+
+	hrtimer_cancel(&gray->timer);
+	cancel_work_sync(&gray->work);
+}
+
+/**
+ * @brief
+ *     Send sub-frames again after system sleep
+ * @note
+ *     Caller has to hold oled->gray_lock, but not oled->lock
+ *
+ * @param[IN] oled    pointer to SSD1306 main handle
+ */
+void ssd1306_gray_resume(struct ssd1306 *oled)
+{
+	struct ssd1306_gray *gray = oled->gray;
+
+	if (!gray)
+		return;
+
+	hrtimer_start(&gray->timer, gray->period, HRTIMER_MODE_REL);
+}
+
+/**
+ * @brief
+ *     Convert gray frame to sub-frames and show it from the next sub-frame
+ * @note
+ *     Caller has to hold oled->gray_lock, but not oled->lock
+ *
+ * @param[IN] oled    pointer to SSD1306 main handle
+ * @param[IN] pxls    row-major pixels, bpp bits each, the first pixel in
+ *                    the most significant bits of a byte
+ *
+ * @return returns zero or negative error
+ */
+int ssd1306_gray_frame(struct ssd1306 *oled, const uint8_t *pxls)
+{
+	struct ssd1306_gray *gray = oled->gray;
+	int x, y, k;
+	uint8_t *swap;
+
+	if (!gray)
+		return -EPERM;
+
+	memset(gray->back, 0, gray->planes * SSD1306_PLANE_SIZE);
+
+	for (y = 0; y < SSD1306_VERTICAL_MAX; y++) {
+		const int base = (y / SSD1306_CELL_CAPACITY) *
+				 SSD1306_HORIZONTAL_MAX;
+		const uint8_t bit = 1 << (y % SSD1306_CELL_CAPACITY);
+
+		for (x = 0; x < SSD1306_HORIZONTAL_MAX; x++) {
+			const int index = y * SSD1306_HORIZONTAL_MAX + x;
+			const int shift = 8 - gray->bpp *
+					  (index % (8 / gray->bpp) + 1);
+			const int level = (pxls[index * gray->bpp / 8] >> shift) &
+					  gray->planes;
+			unsigned int lit = gray->spread[level];
+
+			for (k = 0; lit; k++, lit >>= 1)
+				if (lit & 1)
+					gray->back[k * SSD1306_PLANE_SIZE +
+						   base + x] |= bit;
+		}
+	}
+
+	mutex_lock(&oled->lock);
+	swap = gray->front;
+	gray->front = gray->back;
+	gray->back = swap;
+	mutex_unlock(&oled->lock);
+
+	return 0;
+}
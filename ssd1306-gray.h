@@ -0,0 +1,29 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+
+#define SSD1306_GRAY_FRAME_SIZE(bpp) \
+	(SSD1306_HORIZONTAL_MAX * SSD1306_VERTICAL_MAX * (bpp) / 8)
+#define SSD1306_PLANE_SIZE (SSD1306_HORIZONTAL_MAX * SSD1306_PAGES)
+
+struct ssd1306_gray {
+	struct ssd1306 *oled;
+	struct hrtimer timer;      /*! Sub-frame cadence */
+	struct work_struct work;   /*! Sends one sub-frame */
+	ktime_t period;            /*! Time between sub-frames */
+	ktime_t fired;             /*! When the timer queued the sub-frame */
+	int bpp;                   /*! Bits per pixel of submitted frames */
+	int planes;                /*! Number of 1bpp sub-frames in a cycle */
+	int plane;                 /*! Next sub-frame to send */
+	uint16_t spread[16];       /*! Gray level to mask of lit sub-frames */
+	uint8_t *front;            /*! Sub-frames being shown */
+	uint8_t *back;             /*! Sub-frames being converted */
+	u64 subframes;             /*! Sent sub-frames */
+	u64 overruns;              /*! Ticks missed, previous one still busy */
+	s64 jitter_max_ns;         /*! Worst delay of sub-frame start */
+	s64 jitter_sum_ns;         /*! Sum of delays, for the average */
+};
+
+int ssd1306_gray_enable(struct ssd1306 *oled, int bpp, int rate_hz);
+void ssd1306_gray_disable(struct ssd1306 *oled);
+void ssd1306_gray_suspend(struct ssd1306 *oled);
+void ssd1306_gray_resume(struct ssd1306 *oled);
+int ssd1306_gray_frame(struct ssd1306 *oled, const uint8_t *pxls);
@@ -7,15 +7,32 @@
 #include <linux/fs.h>
 #include <linux/cdev.h>
 #include <linux/i2c.h>
+#include <linux/property.h>
 #include <linux/uaccess.h>
+#include <linux/poll.h>
+#include <linux/hrtimer.h>
+#include <linux/workqueue.h>
+#include <linux/idr.h>
 
 #include "ssd1306.h"
 #include "ssd1306-font.h"
 #include "ssd1306-cmode.h"
+#include "ssd1306-layer.h"
+#include "ssd1306-ioctl.h"
+#include "ssd1306-console.h"
+#include "ssd1306-sprite.h"
+#include "ssd1306-gray.h"
+#include "ssd1306-image.h"
+#include "ssd1306-debugfs.h"
+#include "ssd1306-sysfs.h"
+#include "ssd1306-tile.h"
+#include "ssd1306-orbit.h"
+#include "ssd1306-effect.h"
+#include "ssd1306-mailbox.h"
 
 static dev_t             dev_number;
 static struct class     *disp_class;
-static struct device    *dev_oled;
+static DEFINE_IDA(ssd1306_minors);
 
 static struct i2c_device_id ssd1306_id[] = {
 	{DEVICE_NAME, 0},
@@ -23,10 +40,14 @@ static struct i2c_device_id ssd1306_id[] = {
 };
 static int ssd1306_probe(struct i2c_client *, const struct i2c_device_id *);
 static int ssd1306_remove(struct i2c_client *);
+static int ssd1306_suspend(struct device *);
+static int ssd1306_resume(struct device *);
+static SIMPLE_DEV_PM_OPS(ssd1306_pm_ops, ssd1306_suspend, ssd1306_resume);
 static struct i2c_driver ssd1306_i2c = {
 	.driver = {
 		.name	= DEVICE_NAME,
 		.owner	= THIS_MODULE,
+		.pm	= &ssd1306_pm_ops,
 	},
 	.probe = ssd1306_probe,
 	.remove = ssd1306_remove,
@@ -35,15 +56,26 @@ static struct i2c_driver ssd1306_i2c = {
 
 static ssize_t ssd1306_write(struct file *, const char __user *,
 			     size_t, loff_t *);
+static loff_t ssd1306_llseek(struct file *, loff_t, int);
 static int ssd1306_open(struct inode *, struct file *);
+static int ssd1306_release(struct inode *, struct file *);
+static long ssd1306_ioctl(struct file *, unsigned int, unsigned long);
+static __poll_t ssd1306_poll(struct file *, poll_table *);
+static int ssd1306_fsync(struct file *, loff_t, loff_t, int);
 static struct file_operations fops ={
 	.write = ssd1306_write,
+	.llseek = ssd1306_llseek,
 	.open = ssd1306_open,
+	.release = ssd1306_release,
+	.unlocked_ioctl = ssd1306_ioctl,
+	.poll = ssd1306_poll,
+	.fsync = ssd1306_fsync,
 };
 
 static int ssd1306_open(struct inode *inode, struct file *fd)
 {
 	struct ssd1306 *oled;
+	struct ssd1306_layer *layer;
 
 	oled = container_of(inode->i_cdev, struct ssd1306, char_dev);
 	if (!oled) {
@@ -51,26 +83,170 @@ static int ssd1306_open(struct inode *inode, struct file *fd)
 		return -EPERM;
 	}
 
-	fd -> private_data = oled;
+	//Every open file draws to its own full screen layer
+	layer = ssd1306_layer_create(oled);
+	if (IS_ERR(layer)) {
+		LOG(KERN_WARNING, "Can't create display layer");
+		return PTR_ERR(layer);
+	}
 
-	ssd1306_clear_display(oled);
+	fd -> private_data = layer;
 
 	return 0;
 }
+
+static int ssd1306_release(struct inode *inode, struct file *fd)
+{
+	struct ssd1306_layer *layer = fd->private_data;
+
+	if (layer) {
+		//Sprites of the file are not reachable by anybody else
+		mutex_lock(&layer->oled->lock);
+		ssd1306_sprite_release(layer->oled, layer);
+		mutex_unlock(&layer->oled->lock);
+
+		ssd1306_layer_destroy(layer);
+	}
+
+	fd->private_data = NULL;
+
+	return 0;
+}
+
+/**
+ * @brief
+ *     Render cells of a text line again. Only the cells are cleared and
+ *     composed, so only their columns of the line pages become dirty.
+ * @note
+ *     Caller has to hold oled->lock
+ *
+ * @param[IN] layer    pointer to the layer
+ * @param[IN] line     line number
+ * @param[IN] first    first column
+ * @param[IN] last     last column (inclusive)
+ */
+static void ssd1306_render_cells(struct ssd1306_layer *layer, int line,
+				 int first, int last)
+{
+	const struct ssd1306_cmode *cmode = &layer->cmode;
+	const struct ssd1306_cmode_attr *attr = &cmode->line_attr[line];
+	//Glyph and one pixel of space, both scaled
+	const int pitch = (DEFAULT_FONT_WIDTH + 1) * attr->scale_x;
+	const int height = DEFAULT_FONT_HEIGHT * attr->scale_y;
+	const char *text = cmode->actual_disp[line];
+	int x0, x1, y;
+	int col, l;
+
+	//Scaled lines move the lines below them down
+	y = layer->y;
+	for (l = 0; l < line; l++)
+		y += DEFAULT_FONT_HEIGHT * cmode->line_attr[l].scale_y;
+
+	//Scaled line shows less characters
+	last = min(last, cmode->max_cols / attr->scale_x - 1);
+	if (first > last || y + height > layer->y + layer->height)
+		return;
+
+	x0 = layer->x + first * pitch;
+	x1 = min(layer->x + (last + 1) * pitch,
+		 layer->x + layer->width) - 1;
+
+	ssd1306_layer_clear_area(layer, x0, y, x1, y + height - 1);
+
+	for (col = first; col <= last && text[col]; col++)
+		ssd1306_print_char_scaled_buff(layer->oled, layer->buff,
+					       layer->x + col * pitch, y,
+					       text[col], attr->scale_x,
+					       attr->scale_y);
+
+	layer->drawn = true;
+	ssd1306_compose(layer->oled, x0, y, x1, y + height - 1);
+}
+
+/**
+ * @brief
+ *     Overwrite text cells from position line * max_cols + col, text goes
+ *     on to the next lines. New line character ends the write. Only the
+ *     visible cells of scaled lines are written, text goes on to the next
+ *     line after them.
+ * @note
+ *     Caller has to hold oled->lock
+ *
+ * @param[IN] layer    pointer to the layer
+ * @param[IN] str      characters to write
+ * @param[IN] size     number of characters
+ * @param[IN] pos      cell position
+ *
+ * @return returns number of consumed characters or negative error
+ */
+static int ssd1306_write_cells(struct ssd1306_layer *layer, const char *str,
+			       size_t size, loff_t pos)
+{
+	struct ssd1306_cmode *cmode = &layer->cmode;
+	int line, col;
+	int count = 0;
+	int err;
+
+	if (pos >= cmode->max_buff_size)
+		return -ENOSPC;
+
+	line = (int)pos / cmode->max_cols;
+	col = (int)pos % cmode->max_cols;
+	size = min_t(size_t, size, cmode->max_buff_size);
+
+	for (; count < size && line < cmode->max_lines; line++, col = 0) {
+		//Scaled line shows less characters, hidden cells can't be set
+		const int visible = cmode->max_cols /
+				    cmode->line_attr[line].scale_x;
+
+		if (col >= visible)
+			return -ENOSPC;
+
+		err = ssd1306_cmode_write(cmode, line, col, &str[count],
+					  min_t(size_t, size - count,
+						visible - col));
+		if (err < 0)
+			return err;
+
+		count += err;
+
+		if (str[count - 1] == '\n') {
+			ssd1306_render_cells(layer, line, col, col + err - 2);
+			break;
+		}
+
+		ssd1306_render_cells(layer, line, col, col + err - 1);
+	}
+
+	err = ssd1306_display_dirty(layer->oled);
+	if (err)
+		LOG(KERN_DEBUG, "Write to the display failure");
+
+	return count;
+}
+
+/**
+ * @brief
+ *     Writes at offset zero replace all text of the layer. Writes at other
+ *     offsets overwrite text cells, offset is line * max_cols + col.
+ */
 static ssize_t ssd1306_write(struct file *fd, const char __user *user,
 			     size_t size, loff_t *loff)
 {
+	struct ssd1306_layer *layer;
 	struct ssd1306 *oled;
 	char *str = NULL;
 	int err;
 	int sent_chars = 0;
 	int line = 0;
+	int y;
 
-	oled = fd->private_data;
-	if (!oled) {
+	layer = fd->private_data;
+	if (!layer) {
 		LOG(KERN_WARNING, "Can't find oled device");
 		return -EPERM;
 	}
+	oled = layer->oled;
 
 	str = kmalloc((sizeof(char) * size) + 1, GFP_KERNEL);
 	if (!str) {
@@ -79,39 +255,541 @@ static ssize_t ssd1306_write(struct file *fd, const char __user *user,
 	}
 
 	memset(str, 0, size + 1);
-	err = copy_from_user(str, user, size);
 
-	if (err < 0) {
+	if (copy_from_user(str, user, size)) {
 		LOG(KERN_WARNING, "Copy text from user failed");
+		sent_chars = -EFAULT;
 		goto exit;
 	}
 
-	ssd1306_clear_display(oled);
+	mutex_lock(&oled->lock);
+
+	if (*loff) {
+		sent_chars = ssd1306_write_cells(layer, str, size, *loff);
+		if (sent_chars > 0)
+			*loff += sent_chars;
+		goto unlock;
+	}
 
-	err = ssd1306_cut_str(&oled->cmode, str);
-	if (err >= 0)
+	ssd1306_layer_clear(layer);
+
+	err = ssd1306_cut_str(&layer->cmode, str);
+	if (err >= 0) {
 		sent_chars += err;
-	else
-		return err;
+	} else {
+		sent_chars = err;
+		goto unlock;
+	}
+
+	//Scaled lines move the lines below them down
+	y = layer->y;
+	while(line < layer->cmode.max_lines) {
+		const struct ssd1306_cmode_attr *attr =
+			&layer->cmode.line_attr[line];
 
-	while(line < oled->cmode.max_lines) {
-		err = ssd1306_print_str(oled, 0, line * DEFAULT_FONT_HEIGHT,
-					oled->cmode.actual_disp[line]);
+		if (y + DEFAULT_FONT_HEIGHT * attr->scale_y >
+		    layer->y + layer->height)
+			break;
+
+		err = ssd1306_print_str_scaled_buff(oled, layer->buff,
+					layer->x, y,
+					layer->cmode.actual_disp[line],
+					attr->scale_x, attr->scale_y);
 		if (err < 0)
 			LOG(KERN_DEBUG, "Write the string to the buffer "
 					"failure");
+		y += DEFAULT_FONT_HEIGHT * attr->scale_y;
 		line++;
 	}
 
-	err = ssd1306_display(oled);
+	ssd1306_layer_compose(layer);
+
+	err = ssd1306_display_dirty(oled);
 	if (err)
 		LOG(KERN_DEBUG, "Write to the display failure");
 
+unlock:
+	mutex_unlock(&oled->lock);
 exit:
 	kfree(str);
 	return sent_chars;
 }
 
+/**
+ * @brief
+ *     Text grid of the layer is the file content, one byte per cell
+ */
+static loff_t ssd1306_llseek(struct file *fd, loff_t offset, int whence)
+{
+	struct ssd1306_layer *layer = fd->private_data;
+
+	if (!layer)
+		return -EPERM;
+
+	return fixed_size_llseek(fd, offset, whence,
+				 READ_ONCE(layer->cmode.max_buff_size));
+}
+
+/**
+ * @brief
+ *     Report the device writable when no frame is on the bus and no frame
+ *     submitted by the file waits for the flush work, so the next write
+ *     will not wait for or replace another one.
+ */
+static __poll_t ssd1306_poll(struct file *fd, poll_table *wait)
+{
+	struct ssd1306_layer *layer = fd->private_data;
+	struct ssd1306_mailbox *mb;
+	struct ssd1306 *oled;
+
+	if (!layer)
+		return EPOLLERR;
+	oled = layer->oled;
+
+	poll_wait(fd, &oled->frame_wait, wait);
+
+	mb = smp_load_acquire(&layer->mailbox);
+	if (mb && (atomic_read(&mb->middle) & SSD1306_MAILBOX_FRESH))
+		return 0;
+
+	if (atomic64_read(&oled->frame_completed) ==
+	    atomic64_read(&oled->frame_submitted))
+		return EPOLLOUT | EPOLLWRNORM;
+
+	return 0;
+}
+
+/**
+ * @brief
+ *     Wait until every frame submitted before the call is on the panel.
+ *     Frames still in the mailboxes are sent first.
+ *
+ * @return returns zero or error of the last transfer
+ */
+static int ssd1306_fsync(struct file *fd, loff_t start, loff_t end,
+			 int datasync)
+{
+	struct ssd1306_layer *layer = fd->private_data;
+	struct ssd1306 *oled;
+	s64 target;
+	int err;
+
+	if (!layer)
+		return -EPERM;
+	oled = layer->oled;
+
+	//Published frames are counted only when the work sends them
+	flush_work(&oled->mailbox_work);
+
+	target = atomic64_read(&oled->frame_submitted);
+
+	err = wait_event_interruptible(oled->frame_wait,
+				atomic64_read(&oled->frame_completed) >= target);
+	if (err)
+		return err;
+
+	return READ_ONCE(oled->frame_err);
+}
+
+/**
+ * @brief
+ *     Copy the bitmap from user space and store it in the sprite cache
+ *
+ * @return returns zero or negative error
+ */
+static int ssd1306_ioctl_sprite_upload(struct ssd1306_layer *layer,
+				       struct ssd1306_sprite_upload __user *argp)
+{
+	struct ssd1306 *oled = layer->oled;
+	struct ssd1306_sprite_upload upload;
+	uint8_t *rows;
+	size_t size;
+	int handle;
+
+	if (copy_from_user(&upload, argp, sizeof(upload)))
+		return -EFAULT;
+
+	if (!upload.width || !upload.height ||
+	    upload.width > SSD1306_SPRITE_SIZE_MAX ||
+	    upload.height > SSD1306_SPRITE_SIZE_MAX)
+		return -EINVAL;
+
+	size = DIV_ROUND_UP(upload.width, 8) * upload.height;
+	rows = kmalloc(size, GFP_KERNEL);
+	if (!rows)
+		return -ENOMEM;
+
+	if (copy_from_user(rows, u64_to_user_ptr(upload.data), size)) {
+		kfree(rows);
+		return -EFAULT;
+	}
+
+	handle = ssd1306_sprite_upload(oled, layer, upload.width,
+				       upload.height, rows);
+	kfree(rows);
+	if (handle < 0)
+		return handle;
+
+	if (put_user(handle, &argp->handle)) {
+		mutex_lock(&oled->lock);
+		ssd1306_sprite_free(oled, layer, handle);
+		mutex_unlock(&oled->lock);
+		return -EFAULT;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief
+ *     Copy gray frame from user space and pass it to grayscale engine
+ *
+ * @return returns zero or negative error
+ */
+static int ssd1306_ioctl_gray_frame(struct ssd1306 *oled,
+				    struct ssd1306_gray_frame __user *argp)
+{
+	struct ssd1306_gray_frame frame;
+	uint8_t *pxls;
+	int err;
+
+	if (copy_from_user(&frame, argp, sizeof(frame)))
+		return -EFAULT;
+
+	pxls = kmalloc(SSD1306_GRAY_FRAME_SIZE(4), GFP_KERNEL);
+	if (!pxls)
+		return -ENOMEM;
+
+	mutex_lock(&oled->gray_lock);
+
+	if (!oled->gray) {
+		err = -EPERM;
+		goto unlock;
+	}
+
+	if (copy_from_user(pxls, u64_to_user_ptr(frame.data),
+			   SSD1306_GRAY_FRAME_SIZE(oled->gray->bpp))) {
+		err = -EFAULT;
+		goto unlock;
+	}
+
+	err = ssd1306_gray_frame(oled, pxls);
+
+unlock:
+	mutex_unlock(&oled->gray_lock);
+	kfree(pxls);
+
+	return err;
+}
+
+/**
+ * @brief
+ *     Copy 1bpp image from user space and draw it into the file layer
+ *
+ * @return returns zero or negative error
+ */
+static int ssd1306_ioctl_image(struct ssd1306_layer *layer,
+			       struct ssd1306_image __user *argp)
+{
+	struct ssd1306 *oled = layer->oled;
+	struct ssd1306_image image;
+	int width, height;
+	int raster;
+	uint8_t *data;
+	int err;
+
+	if (copy_from_user(&image, argp, sizeof(image)))
+		return -EFAULT;
+
+	if (image.x < 0 || image.x >= ssd1306_width(oled) ||
+	    image.y < 0 || image.y >= ssd1306_height(oled))
+		return -EINVAL;
+
+	data = ssd1306_image_load(&image, &width, &height, &raster);
+	if (IS_ERR(data))
+		return PTR_ERR(data);
+
+	mutex_lock(&oled->lock);
+
+	if (image.flags & SSD1306_IMAGE_CLEAR)
+		ssd1306_layer_clear(layer);
+
+	ssd1306_image_blit(oled, layer->buff, image.x, image.y, width, height,
+			   &data[raster]);
+	ssd1306_layer_compose(layer);
+	err = ssd1306_display_dirty(oled);
+
+	mutex_unlock(&oled->lock);
+
+	kfree(data);
+
+	return err;
+}
+
+/**
+ * @brief
+ *     Copy frame from user space into mailbox of the file layer. Only other
+ *     producers of the same file are waited for, never the bus.
+ *
+ * @return returns zero or negative error
+ */
+static int ssd1306_ioctl_submit_frame(struct ssd1306_layer *layer,
+				      struct ssd1306_frame __user *argp)
+{
+	struct ssd1306 *oled = layer->oled;
+	struct ssd1306_mailbox *mb;
+	struct ssd1306_frame frame;
+	int err = 0;
+
+	if (copy_from_user(&frame, argp, sizeof(frame)))
+		return -EFAULT;
+
+	if (frame.size != ssd1306_width(oled) / 8 * ssd1306_height(oled))
+		return -EINVAL;
+
+	mb = ssd1306_mailbox_get(layer);
+	if (IS_ERR(mb))
+		return PTR_ERR(mb);
+
+	mutex_lock(&mb->lock);
+
+	if (copy_from_user(mb->rows, u64_to_user_ptr(frame.data), frame.size))
+		err = -EFAULT;
+	else
+		ssd1306_mailbox_publish(layer, mb);
+
+	mutex_unlock(&mb->lock);
+
+	return err;
+}
+
+/**
+ * @brief
+ *     Copy string from user space and draw it scaled into the file layer
+ *
+ * @return returns zero or negative error
+ */
+static int ssd1306_ioctl_text(struct ssd1306_layer *layer,
+			      struct ssd1306_text __user *argp)
+{
+	struct ssd1306 *oled = layer->oled;
+	struct ssd1306_text text;
+	char *str;
+	int err;
+
+	if (copy_from_user(&text, argp, sizeof(text)))
+		return -EFAULT;
+
+	//Every character takes more than one column
+	if (!text.size || text.size > ssd1306_width(oled))
+		return -EINVAL;
+
+	str = kzalloc(text.size + 1, GFP_KERNEL);
+	if (!str)
+		return -ENOMEM;
+
+	if (copy_from_user(str, u64_to_user_ptr(text.data), text.size)) {
+		err = -EFAULT;
+		goto exit;
+	}
+
+	mutex_lock(&oled->lock);
+
+	if (text.flags & SSD1306_TEXT_CLEAR)
+		ssd1306_layer_clear(layer);
+
+	err = ssd1306_print_str_scaled_buff(oled, layer->buff, text.x, text.y,
+					    str, text.scale_x, text.scale_y);
+	if (!err) {
+		ssd1306_layer_compose(layer);
+		err = ssd1306_display_dirty(oled);
+	}
+
+	mutex_unlock(&oled->lock);
+
+exit:
+	kfree(str);
+
+	return err;
+}
+
+static long ssd1306_ioctl(struct file *fd, unsigned int cmd, unsigned long arg)
+{
+	struct ssd1306_layer *layer = fd->private_data;
+	void __user *argp = (void __user *)arg;
+	struct ssd1306_layer_cfg cfg;
+	struct ssd1306_frame_info info;
+	struct ssd1306_sprite_draw draw;
+	struct ssd1306_gray_cfg gray_cfg;
+	struct ssd1306_gray_stats stats;
+	struct ssd1306_line_attr attr;
+	struct ssd1306_effect effect;
+	struct ssd1306 *oled;
+	int handle;
+	int err;
+
+	if (!layer) {
+		LOG(KERN_WARNING, "Can't find oled device");
+		return -EPERM;
+	}
+	oled = layer->oled;
+
+	switch (cmd) {
+	case SSD1306_IOC_SET_LAYER:
+		if (copy_from_user(&cfg, argp, sizeof(cfg)))
+			return -EFAULT;
+
+		mutex_lock(&oled->lock);
+		err = ssd1306_layer_set(layer, cfg.x, cfg.y, cfg.width,
+					cfg.height, cfg.z);
+		if (!err)
+			err = ssd1306_display_dirty(oled);
+		mutex_unlock(&oled->lock);
+
+		return err;
+
+	case SSD1306_IOC_GET_LAYER:
+		mutex_lock(&oled->lock);
+		cfg.x = layer->x;
+		cfg.y = layer->y;
+		cfg.width = layer->width;
+		cfg.height = layer->height;
+		cfg.z = layer->z;
+		mutex_unlock(&oled->lock);
+
+		if (copy_to_user(argp, &cfg, sizeof(cfg)))
+			return -EFAULT;
+
+		return 0;
+
+	case SSD1306_IOC_GET_FRAME_INFO:
+		memset(&info, 0, sizeof(info));
+
+		mutex_lock(&oled->lock);
+		info.seq = atomic64_read(&oled->frame_completed);
+		info.timestamp_ns = ktime_to_ns(oled->frame_time);
+		info.status = oled->frame_err;
+		mutex_unlock(&oled->lock);
+
+		if (copy_to_user(argp, &info, sizeof(info)))
+			return -EFAULT;
+
+		return 0;
+
+	case SSD1306_IOC_SPRITE_UPLOAD:
+		return ssd1306_ioctl_sprite_upload(layer, argp);
+
+	case SSD1306_IOC_SPRITE_DRAW:
+		if (copy_from_user(&draw, argp, sizeof(draw)))
+			return -EFAULT;
+
+		mutex_lock(&oled->lock);
+		err = ssd1306_sprite_draw(oled, layer, layer->buff,
+					  draw.handle, draw.x, draw.y,
+					  draw.rop);
+		if (!err) {
+			ssd1306_layer_compose(layer);
+			err = ssd1306_display_dirty(oled);
+		}
+		mutex_unlock(&oled->lock);
+
+		return err;
+
+	case SSD1306_IOC_SPRITE_FREE:
+		if (get_user(handle, (__s32 __user *)argp))
+			return -EFAULT;
+
+		mutex_lock(&oled->lock);
+		err = ssd1306_sprite_free(oled, layer, handle);
+		mutex_unlock(&oled->lock);
+
+		return err;
+
+	case SSD1306_IOC_SET_GRAY:
+		if (copy_from_user(&gray_cfg, argp, sizeof(gray_cfg)))
+			return -EFAULT;
+
+		err = 0;
+
+		mutex_lock(&oled->gray_lock);
+		if (gray_cfg.bpp)
+			err = ssd1306_gray_enable(oled, gray_cfg.bpp,
+						  gray_cfg.rate_hz);
+		else
+			ssd1306_gray_disable(oled);
+		mutex_unlock(&oled->gray_lock);
+
+		return err;
+
+	case SSD1306_IOC_GRAY_FRAME:
+		return ssd1306_ioctl_gray_frame(oled, argp);
+
+	case SSD1306_IOC_GET_GRAY_STATS:
+		memset(&stats, 0, sizeof(stats));
+
+		mutex_lock(&oled->gray_lock);
+		if (!oled->gray) {
+			mutex_unlock(&oled->gray_lock);
+			return -EPERM;
+		}
+
+		mutex_lock(&oled->lock);
+		stats.subframes = oled->gray->subframes;
+		stats.overruns = oled->gray->overruns;
+		stats.jitter_max_ns = oled->gray->jitter_max_ns;
+		if (stats.subframes)
+			stats.jitter_avg_ns = div64_u64(
+				oled->gray->jitter_sum_ns, stats.subframes);
+		mutex_unlock(&oled->lock);
+		mutex_unlock(&oled->gray_lock);
+
+		if (copy_to_user(argp, &stats, sizeof(stats)))
+			return -EFAULT;
+
+		return 0;
+
+	case SSD1306_IOC_IMAGE:
+		return ssd1306_ioctl_image(layer, argp);
+
+	case SSD1306_IOC_TEXT:
+		return ssd1306_ioctl_text(layer, argp);
+
+	case SSD1306_IOC_SET_LINE_ATTR:
+		if (copy_from_user(&attr, argp, sizeof(attr)))
+			return -EFAULT;
+
+		if (attr.scale_x < 1 || attr.scale_x > SSD1306_FONT_SCALE_MAX ||
+		    attr.scale_y < 1 || attr.scale_y > SSD1306_FONT_SCALE_MAX)
+			return -EINVAL;
+
+		mutex_lock(&oled->lock);
+		if (attr.line < layer->cmode.max_lines) {
+			layer->cmode.line_attr[attr.line].scale_x =
+				attr.scale_x;
+			layer->cmode.line_attr[attr.line].scale_y =
+				attr.scale_y;
+			err = 0;
+		} else {
+			err = -EINVAL;
+		}
+		mutex_unlock(&oled->lock);
+
+		return err;
+
+	case SSD1306_IOC_SUBMIT_FRAME:
+		return ssd1306_ioctl_submit_frame(layer, argp);
+
+	case SSD1306_IOC_EFFECT:
+		if (copy_from_user(&effect, argp, sizeof(effect)))
+			return -EFAULT;
+
+		return ssd1306_effect_start(oled, &effect);
+
+	default:
+		return -ENOTTY;
+	}
+}
+
 /**
  * @brief
  *     Setup SSD1306 device.
@@ -123,30 +801,99 @@ exit:
  */
 static int ssd1306_setup(struct ssd1306 *oled, struct i2c_client *client)
 {
+	u32 rotation;
+	u32 dclk_div, dclk_frq, prechargep1, prechargep2, vcomh;
+
 	if (!client || !oled) {
 		LOG(KERN_ALERT, "I2C client does not exist");
 		return -EPERM;
 	}
 
 	oled->i2c_client = client;
+	mutex_init(&oled->lock);
+	mutex_init(&oled->gray_lock);
+	INIT_LIST_HEAD(&oled->layers);
+	init_waitqueue_head(&oled->frame_wait);
+	INIT_WORK(&oled->mailbox_work, ssd1306_mailbox_work);
+	oled->contrast = 0xFF;
 
 	oled->disp_buff = (uint8_t*)kmalloc(DISP_BUFF_SIZE, GFP_KERNEL);
-	if (!oled->disp_buff)
+	oled->base_buff = (uint8_t*)kzalloc(DISP_BUFF_SIZE, GFP_KERNEL);
+	oled->tx_buff = (uint8_t*)kmalloc(DISP_BUFF_SIZE, GFP_KERNEL);
+	oled->sent_buff = (uint8_t*)kzalloc(DISP_BUFF_SIZE, GFP_KERNEL);
+	oled->rot_buff = (uint8_t*)kzalloc(DISP_BUFF_SIZE, GFP_KERNEL);
+	if (!oled->disp_buff || !oled->base_buff || !oled->tx_buff ||
+	    !oled->sent_buff || !oled->rot_buff) {
+		kfree(oled->disp_buff);
+		kfree(oled->base_buff);
+		kfree(oled->tx_buff);
+		kfree(oled->sent_buff);
+		kfree(oled->rot_buff);
 		return -ENOMEM;
+	}
 
-	memset(oled->disp_buff, 0, DISP_BUFF_SIZE);
+	//Panel mounting, hardware applies it in ssd1306_init_hw()
+	if (device_property_read_u32(&client->dev, "rotation", &rotation))
+		rotation = 0;
 
-	//Inform the driver about data stream:
-	oled->disp_buff[0] = (uint8_t)SET_DISP_START_LINE;
+	if (rotation != 0 && rotation != 90 && rotation != 180 &&
+	    rotation != 270) {
+		LOG(KERN_WARNING, "Unsupported rotation %u, using 0", rotation);
+		rotation = 0;
+	}
 
-	/**
-	 * TODO: Currently try to setup character mode using default
-	 *       configuration until getting parameters from device tree
-	 *       will not provided
-	 */
-	return ssd1306_cmode_setup(&oled->cmode, DEFAULT_FONT_WIDTH,
-				   DEFAULT_FONT_HEIGHT, SSD1306_HORIZONTAL_MAX,
-				   SSD1306_VERTICAL_MAX);
+#ifdef CONFIG_SSD1306_FIXED_GEOMETRY
+	if (rotation == 90 || rotation == 270) {
+		LOG(KERN_WARNING, "Fixed geometry build, using rotation %u",
+		    rotation - 90);
+		rotation -= 90;
+	}
+#endif
+
+	oled->rotation = rotation;
+	oled->mirror_x = device_property_read_bool(&client->dev, "mirror-x");
+	oled->mirror_y = device_property_read_bool(&client->dev, "mirror-y");
+	oled->tile_index = -1;
+
+	//Panel timing, same properties as the ssd1307fb driver uses
+	dclk_div = (SSD1306_DISP_CLOCK_DEV & 0x0F) + 1;
+	dclk_frq = SSD1306_DISP_CLOCK_DEV >> 4;
+	prechargep1 = SSD1306_PRECHARGE_PERIOD & 0x0F;
+	prechargep2 = SSD1306_PRECHARGE_PERIOD >> 4;
+	vcomh = SSD1306_VCOMH_LEVEL;
+	device_property_read_u32(&client->dev, "solomon,dclk-div", &dclk_div);
+	device_property_read_u32(&client->dev, "solomon,dclk-frq", &dclk_frq);
+	device_property_read_u32(&client->dev, "solomon,prechargep1",
+				 &prechargep1);
+	device_property_read_u32(&client->dev, "solomon,prechargep2",
+				 &prechargep2);
+	device_property_read_u32(&client->dev, "solomon,vcomh", &vcomh);
+
+	if (dclk_div < 1 || dclk_div > 16 || dclk_frq > 15 ||
+	    prechargep1 < 1 || prechargep1 > 15 ||
+	    prechargep2 < 1 || prechargep2 > 15 || (vcomh & ~0x70)) {
+		LOG(KERN_WARNING, "Unsupported panel timing, using defaults");
+		oled->clock = SSD1306_DISP_CLOCK_DEV;
+		oled->precharge = SSD1306_PRECHARGE_PERIOD;
+		oled->vcomh = SSD1306_VCOMH_LEVEL;
+	} else {
+		oled->clock = dclk_frq << 4 | (dclk_div - 1);
+		oled->precharge = prechargep2 << 4 | prechargep1;
+		oled->vcomh = vcomh;
+	}
+
+	if (ssd1306_transposed(oled)) {
+		oled->canvas = oled->rot_buff;
+		oled->width = SSD1306_VERTICAL_MAX;
+		oled->height = SSD1306_HORIZONTAL_MAX;
+	} else {
+		oled->canvas = oled->disp_buff;
+		oled->width = SSD1306_HORIZONTAL_MAX;
+		oled->height = SSD1306_VERTICAL_MAX;
+	}
+
+	//Inform the driver about data stream and send whole frame first time:
+	return ssd1306_clear_display(oled);
 }
 
 /**
@@ -159,7 +906,13 @@ static int ssd1306_setup(struct ssd1306 *oled, struct i2c_client *client)
 static void ssd1306_free(struct ssd1306 *oled)
 {
 	kfree(oled->disp_buff);
-	ssd1306_cmode_free(&oled->cmode);
+	kfree(oled->base_buff);
+	kfree(oled->tx_buff);
+	kfree(oled->sent_buff);
+	kfree(oled->rot_buff);
+	kfree(oled->orbit);
+	kfree(oled->effects);
+	ssd1306_sprite_free_all(oled);
 }
 /**
  * @brief
@@ -174,7 +927,9 @@ static int ssd1306_probe(struct i2c_client *client,
 			 const struct i2c_device_id *id)
 {
 	struct ssd1306 *oled;
-
+	dev_t devt;
+	u32 tile_index;
+	int minor;
 	int err;
 
 	if (!client || !id) {
@@ -182,21 +937,30 @@ static int ssd1306_probe(struct i2c_client *client,
 		return -EPERM;
 	}
 
-	oled = (struct ssd1306 *)kmalloc(sizeof(struct ssd1306), GFP_KERNEL);
+	oled = (struct ssd1306 *)kzalloc(sizeof(struct ssd1306), GFP_KERNEL);
 	if (IS_ERR_OR_NULL(oled)) {
 		LOG(KERN_DEBUG, "Cannot allocate memory for driver");
 		return -ENOMEM;
 	}
 
+	minor = ida_alloc_max(&ssd1306_minors, SSD1306_DEVICES_MAX - 1,
+			      GFP_KERNEL);
+	if (minor < 0) {
+		LOG(KERN_ALERT, "No free minor for next display");
+		err = minor;
+		goto err_malloc;
+	}
+	devt = MKDEV(MAJOR(dev_number), MINOR_BASE + minor);
+
 	/* Initialize character device for any text related operations
 	 * with display
 	 */
 	cdev_init(&oled->char_dev, &fops);
 
-	err = cdev_add(&oled->char_dev, dev_number, 1);
+	err = cdev_add(&oled->char_dev, devt, 1);
 	if (err) {
 		LOG(KERN_ALERT, "Character device failed to add");
-		goto err_malloc;
+		goto err_minor;
 	}
 
 	err = ssd1306_setup(oled, client);
@@ -205,19 +969,31 @@ static int ssd1306_probe(struct i2c_client *client,
 		goto err_cdev;
 	}
 
-	dev_oled = device_create(disp_class, NULL, dev_number,
-				NULL, DEVICE_NAME);
+	err = ssd1306_orbit_init(oled);
+	if (!err)
+		err = ssd1306_effect_init(oled);
+	if (err)
+		goto err_setup;
+
+	//First display keeps the plain name, next ones are numbered
+	if (minor)
+		oled->device = device_create_with_groups(disp_class, NULL,
+					devt, oled, ssd1306_groups,
+					DEVICE_NAME "-%d", minor);
+	else
+		oled->device = device_create_with_groups(disp_class, NULL,
+					devt, oled, ssd1306_groups,
+					DEVICE_NAME);
 
-	if (IS_ERR(dev_oled)) {
-		err = IS_ERR(dev_oled);
+	if (IS_ERR(oled->device)) {
+		err = PTR_ERR(oled->device);
 		LOG(KERN_DEBUG, "Cannot create oled device");
 		goto err_setup;
 	}
 
 	i2c_set_clientdata(client, oled);
-	dev_set_drvdata(dev_oled, oled);
 
-	LOG(KERN_DEBUG, "Device %s created", DEVICE_NAME);
+	LOG(KERN_DEBUG, "Device %s created", dev_name(oled->device));
 
 	err = ssd1306_init_hw(oled);
 	if (err) {
@@ -225,16 +1001,30 @@ static int ssd1306_probe(struct i2c_client *client,
 		goto err_device;
 	}
 
+	ssd1306_debugfs_add(oled);
+
+	err = ssd1306_console_register(oled);
+	if (err)
+		LOG(KERN_DEBUG, "Kernel console is not registered");
+
+	if (!device_property_read_u32(&client->dev, "tile-index",
+				      &tile_index) &&
+	    ssd1306_tile_set(oled, tile_index))
+		LOG(KERN_WARNING, "Cannot place display at tile %u",
+		    tile_index);
+
 	LOG(KERN_DEBUG, "Driver successfully probed");
 
 	return 0;
 
 err_device:
-	class_destroy(disp_class);
+	device_destroy(disp_class, devt);
 err_setup:
 	ssd1306_free(oled);
 err_cdev:
 	cdev_del(&oled->char_dev);
+err_minor:
+	ida_free(&ssd1306_minors, minor);
 err_malloc:
 	kfree(oled);
 
@@ -244,6 +1034,7 @@ err_malloc:
 static int ssd1306_remove(struct i2c_client *client)
 {
 	struct ssd1306* oled;
+	dev_t devt;
 
 	if (!client) {
 		LOG(KERN_ALERT, "I2C client device does not exist");
@@ -257,14 +1048,111 @@ static int ssd1306_remove(struct i2c_client *client)
 		return -ENXIO;
 	}
 
+	//Attributes reach the orbit and effects, remove them first
+	devt = oled->char_dev.dev;
+	device_destroy(disp_class, devt);
+
+	ssd1306_tile_remove(oled);
+
+	ssd1306_orbit_exit(oled);
+
+	ssd1306_effect_exit(oled);
+
+	cancel_work_sync(&oled->mailbox_work);
+
+	ssd1306_console_unregister(oled);
+
+	mutex_lock(&oled->gray_lock);
+	ssd1306_gray_disable(oled);
+	mutex_unlock(&oled->gray_lock);
+
 	(void)ssd1306_deinit_hw(oled);
 
-	kfree(oled->disp_buff);
+	ssd1306_debugfs_remove(oled);
+
+	cdev_del(&oled->char_dev);
+	ida_free(&ssd1306_minors, MINOR(devt) - MINOR_BASE);
+
+	ssd1306_free(oled);
+	kfree(oled);
 
 	LOG(KERN_DEBUG, "I2C bus driver for display removed");
 
 	return 0;
 }
+/**
+ * @brief
+ *     Turn the panel off for system sleep. Running effect is stopped, so
+ *     a blink step can't turn the panel on again. Grayscale sub-frames,
+ *     submitted frames and orbit steps wait, so nothing talks to the
+ *     sleeping controller.
+ *
+ * @param[IN] *dev    pointer to I2C client device
+ *
+ * @return returns zero or negative error
+ */
+static int __maybe_unused ssd1306_suspend(struct device *dev)
+{
+	struct ssd1306 *oled = i2c_get_clientdata(to_i2c_client(dev));
+	int err;
+
+	(void)ssd1306_effect_stop(oled);
+
+	mutex_lock(&oled->gray_lock);
+	ssd1306_gray_suspend(oled);
+	mutex_unlock(&oled->gray_lock);
+
+	cancel_work_sync(&oled->mailbox_work);
+	ssd1306_orbit_suspend(oled);
+
+	mutex_lock(&oled->lock);
+
+	err = ssd1306_enable_display(oled, false);
+	if (!err)
+		err = ssd1306_enable_charge_pump(oled, false);
+
+	mutex_unlock(&oled->lock);
+
+	return err;
+}
+
+/**
+ * @brief
+ *     Controller may lose its configuration during sleep. Initialize it
+ *     again, which drops the cached controller state, and send whole frame.
+ *     Grayscale sub-frames, frames submitted meanwhile and the orbit
+ *     follow.
+ *
+ * @param[IN] *dev    pointer to I2C client device
+ *
+ * @return returns zero or negative error
+ */
+static int __maybe_unused ssd1306_resume(struct device *dev)
+{
+	struct ssd1306 *oled = i2c_get_clientdata(to_i2c_client(dev));
+	int err;
+
+	mutex_lock(&oled->lock);
+
+	err = ssd1306_init_hw(oled);
+	if (!err)
+		err = ssd1306_display_dirty(oled);
+
+	mutex_unlock(&oled->lock);
+
+	if (err)
+		return err;
+
+	mutex_lock(&oled->gray_lock);
+	ssd1306_gray_resume(oled);
+	mutex_unlock(&oled->gray_lock);
+
+	queue_work(system_highpri_wq, &oled->mailbox_work);
+	ssd1306_orbit_resume(oled);
+
+	return 0;
+}
+
 /**
  * @brief
  *     Kernel module initialization function. Creates character device for
@@ -292,6 +1180,13 @@ static int __init ssd1306_init(void)
 		goto err_class;
 	}
 
+	ssd1306_font_init();
+
+	err = ssd1306_tile_init(disp_class, MKDEV(MAJOR(dev_number),
+						  SSD1306_TILE_MINOR));
+	if (err)
+		goto err_tile;
+
 	err = i2c_add_driver(&ssd1306_i2c);
 	if (err) {
 		LOG(KERN_ALERT, "Can't register I2C driver %s",
@@ -303,6 +1198,8 @@ static int __init ssd1306_init(void)
 	return 0;
 
 err_i2c:
+	ssd1306_tile_exit();
+err_tile:
 	class_destroy(disp_class);
 err_class:
 	unregister_chrdev_region(dev_number, MINOR_COUNT);
@@ -317,7 +1214,7 @@ err_alloc:
 static void __exit ssd1306_exit(void)
 {
 	i2c_del_driver(&ssd1306_i2c);
-	device_destroy(disp_class, dev_number);
+	ssd1306_tile_exit();
 	class_destroy(disp_class);
 	unregister_chrdev_region(dev_number, MINOR_COUNT);
 
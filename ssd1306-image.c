@@ -0,0 +1,206 @@
+// SPDX-License-Identifier: (GPL-2.0 OR MIT)
+
+#include <linux/kernel.h>
+#include <linux/string.h>
+#include <linux/slab.h>
+#include <linux/uaccess.h>
+
+#include "ssd1306.h"
+#include "ssd1306-image.h"
+#include "ssd1306-ioctl.h"
+
+/**
+ * @brief
+ *     Skip white space and comments of PBM header
+ */
+static size_t ssd1306_pbm_skip(const uint8_t *data, size_t size, size_t pos)
+{
+	while (pos < size) {
+		if (data[pos] == '#') {
+			while (pos < size && data[pos] != '\n')
+				pos++;
+		} else if (data[pos] == ' ' || data[pos] == '\t' ||
+			   data[pos] == '\r' || data[pos] == '\n') {
+			pos++;
+		} else {
+			break;
+		}
+	}
+
+	return pos;
+}
+
+/**
+ * @brief
+ *     Read decimal number of PBM header
+ */
+static size_t ssd1306_pbm_number(const uint8_t *data, size_t size, size_t pos,
+				 int *value)
+{
+	*value = 0;
+
+	while (pos < size && data[pos] >= '0' && data[pos] <= '9') {
+		if (*value > SSD1306_IMAGE_SIZE_MAX * 8)
+			return 0;
+
+		*value = *value * 10 + data[pos++] - '0';
+	}
+
+	return pos;
+}
+
+/**
+ * @brief
+ *     Parse header of binary PBM (P4) image
+ *
+ * @param[IN]  data      image data
+ * @param[IN]  size      image size in bytes
+ * @param[OUT] width     image width
+ * @param[OUT] height    image height
+ *
+ * @return returns offset of the raster or negative error
+ */
+int ssd1306_pbm_header(const uint8_t *data, size_t size, int *width,
+		       int *height)
+{
+	size_t pos;
+
+	if (size < 2 || data[0] != 'P' || data[1] != '4') {
+		LOG(KERN_DEBUG, "Image is not binary PBM (P4)");
+		return -EINVAL;
+	}
+
+	pos = ssd1306_pbm_skip(data, size, 2);
+	pos = ssd1306_pbm_number(data, size, pos, width);
+	if (!pos)
+		return -EINVAL;
+
+	pos = ssd1306_pbm_skip(data, size, pos);
+	pos = ssd1306_pbm_number(data, size, pos, height);
+
+	//Exactly one white space character ends the header
+	if (!pos || pos >= size || !*width || !*height)
+		return -EINVAL;
+
+	return pos + 1;
+}
+
+/**
+ * @brief
+ *     Copy row-major 1bpp image (MSB first, rows padded to full byte) into
+ *     any buffer laid out like the canvas. Each 8x8 block is converted to
+ *     page format with one word-parallel transpose: byte i of the block
+ *     holds row i, byte 7 - j of the result holds column j. Parts out of
+ *     the canvas are clipped.
+ *
+ * @param[IN] oled      pointer to SSD1306 main handle
+ * @param[IN] buff      pointer to the page buffer
+ * @param[IN] x         left column of the image, zero or more
+ * @param[IN] y         top row of the image, zero or more
+ * @param[IN] width     image width
+ * @param[IN] height    image height
+ * @param[IN] rows      image rows
+ */
+void ssd1306_image_blit(struct ssd1306 *oled, uint8_t *buff, int x, int y,
+			int width, int height, const uint8_t *rows)
+{
+	const int offset = DISP_BUFF_OFFSET;
+	const int stride = DIV_ROUND_UP(width, 8);
+	const int shift = y % SSD1306_CELL_CAPACITY;
+	int block_x, block_y, row, col;
+
+	width = min(width, ssd1306_width(oled) - x);
+	height = min(height, ssd1306_height(oled) - y);
+
+	for (block_y = 0; block_y < height; block_y += 8) {
+		const int rows_in = min(8, height - block_y);
+		const uint8_t mask = 0xFF >> (8 - rows_in);
+		const int page = (y + block_y) / SSD1306_CELL_CAPACITY;
+		uint8_t *dst = &buff[offset + page * ssd1306_width(oled) + x];
+		uint8_t *next = dst + ssd1306_width(oled);
+		const bool split = shift && (page + 1) * SSD1306_CELL_CAPACITY <
+					    ssd1306_height(oled);
+
+		for (block_x = 0; block_x < width; block_x += 8) {
+			const int cols_in = min(8, width - block_x);
+			u64 block = 0;
+
+			for (row = 0; row < rows_in; row++)
+				block |= (u64)rows[(block_y + row) * stride +
+						   block_x / 8] << (8 * row);
+
+			block = ssd1306_transpose8(block);
+
+			for (col = 0; col < cols_in; col++) {
+				const uint8_t pxls = (block >> (8 * (7 - col))) &
+						     mask;
+				const int dst_col = block_x + col;
+
+				dst[dst_col] = (dst[dst_col] & ~(mask << shift)) |
+					       (pxls << shift);
+				if (split)
+					next[dst_col] = (next[dst_col] &
+						~(mask >> (8 - shift))) |
+						(pxls >> (8 - shift));
+			}
+		}
+	}
+}
+
+/**
+ * @brief
+ *     Copy the image of SSD1306_IOC_IMAGE request from user space. Image
+ *     without given size has to start with PBM header.
+ *
+ * @param[IN]  image     image request
+ * @param[OUT] width     image width
+ * @param[OUT] height    image height
+ * @param[OUT] raster    offset of the first image row in returned data
+ *
+ * @return returns image data to free with kfree() or error pointer
+ */
+uint8_t *ssd1306_image_load(const struct ssd1306_image *image, int *width,
+			    int *height, int *raster)
+{
+	uint8_t *data;
+	int err;
+
+	if (!image->size || image->size > SSD1306_IMAGE_SIZE_MAX ||
+	    image->width > image->size * 8 || image->height > image->size * 8)
+		return ERR_PTR(-EINVAL);
+
+	data = kmalloc(image->size, GFP_KERNEL);
+	if (!data)
+		return ERR_PTR(-ENOMEM);
+
+	if (copy_from_user(data, u64_to_user_ptr(image->data), image->size)) {
+		err = -EFAULT;
+		goto err_free;
+	}
+
+	*width = image->width;
+	*height = image->height;
+	*raster = 0;
+	if (!*width && !*height) {
+		*raster = ssd1306_pbm_header(data, image->size, width, height);
+		if (*raster < 0) {
+			err = *raster;
+			goto err_free;
+		}
+	}
+
+	if (!*width || !*height ||
+	    (u64)DIV_ROUND_UP(*width, 8) * *height > image->size - *raster) {
+		LOG(KERN_DEBUG, "Image %dx%d does not fit %u bytes", *width,
+		    *height, image->size);
+		err = -EINVAL;
+		goto err_free;
+	}
+
+	return data;
+
+err_free:
+	kfree(data);
+
+	return ERR_PTR(err);
+}
@@ -0,0 +1,12 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+
+#define SSD1306_IMAGE_SIZE_MAX    PAGE_SIZE
+
+struct ssd1306_image;
+
+int ssd1306_pbm_header(const uint8_t *data, size_t size, int *width,
+		       int *height);
+void ssd1306_image_blit(struct ssd1306 *oled, uint8_t *buff, int x, int y,
+			int width, int height, const uint8_t *rows);
+uint8_t *ssd1306_image_load(const struct ssd1306_image *image, int *width,
+			    int *height, int *raster);
@@ -0,0 +1,215 @@
+/* SPDX-License-Identifier: GPL-2.0 WITH Linux-syscall-note */
+/*
+ * ioctl interface of /dev/ssd1306, shared with user space applications.
+ */
+
+#include <linux/ioctl.h>
+#include <linux/types.h>
+
+#define SSD1306_IOC_MAGIC    'S'
+
+/**
+ * Layer of a single open file. Everything the file draws is clipped to the
+ * rectangle and stacked over layers with lower (or equal, older) z.
+ */
+struct ssd1306_layer_cfg {
+	__s32 x;       /*! Left column of the layer */
+	__s32 y;       /*! Top row of the layer */
+	__s32 width;   /*! Width in pixels, at least 9 (character and space) */
+	__s32 height;  /*! Height in pixels, at least 8 (character) */
+	__s32 z;       /*! Stacking order, higher is drawn on top */
+};
+
+#define SSD1306_IOC_SET_LAYER \
+	_IOW(SSD1306_IOC_MAGIC, 0x01, struct ssd1306_layer_cfg)
+#define SSD1306_IOC_GET_LAYER \
+	_IOR(SSD1306_IOC_MAGIC, 0x02, struct ssd1306_layer_cfg)
+
+/**
+ * Last frame which reached the panel
+ */
+struct ssd1306_frame_info {
+	__u64 seq;           /*! Monotonic number of finished frames */
+	__s64 timestamp_ns;  /*! CLOCK_MONOTONIC time the frame finished */
+	__s32 status;        /*! Zero or negative error of the transfer */
+	__u32 reserved;
+};
+
+#define SSD1306_IOC_GET_FRAME_INFO \
+	_IOR(SSD1306_IOC_MAGIC, 0x03, struct ssd1306_frame_info)
+
+/**
+ * Raster operations used while drawing cached sprites
+ */
+enum ssd1306_rop {
+	SSD1306_ROP_COPY,   /*! Replace pixels under the sprite */
+	SSD1306_ROP_OR,     /*! Set pixels set in the sprite */
+	SSD1306_ROP_CLEAR,  /*! Clear pixels set in the sprite */
+	SSD1306_ROP_XOR,    /*! Invert pixels set in the sprite */
+};
+
+/**
+ * 1bpp bitmap uploaded to the sprite cache. Rows are MSB first and padded
+ * to full byte, like in PBM (P4) image.
+ */
+struct ssd1306_sprite_upload {
+	__u32 width;   /*! Width in pixels */
+	__u32 height;  /*! Height in pixels */
+	__u64 data;    /*! User pointer to the rows */
+	__s32 handle;  /*! Returned sprite handle */
+	__u32 reserved;
+};
+
+/**
+ * Cached sprite drawn into layer of the file at x, y. Only the file which
+ * uploaded the sprite can draw and free it, it is freed when the file is
+ * closed.
+ */
+struct ssd1306_sprite_draw {
+	__s32 handle;  /*! Sprite handle */
+	__s32 x;       /*! Left column, may be out of the display */
+	__s32 y;       /*! Top row, may be out of the display */
+	__u32 rop;     /*! One of enum ssd1306_rop */
+};
+
+#define SSD1306_IOC_SPRITE_UPLOAD \
+	_IOWR(SSD1306_IOC_MAGIC, 0x04, struct ssd1306_sprite_upload)
+#define SSD1306_IOC_SPRITE_DRAW \
+	_IOW(SSD1306_IOC_MAGIC, 0x05, struct ssd1306_sprite_draw)
+#define SSD1306_IOC_SPRITE_FREE \
+	_IOW(SSD1306_IOC_MAGIC, 0x06, __s32)
+
+/**
+ * Grayscale mode. Frames are shown as a loop of 2^bpp - 1 sub-frames.
+ */
+struct ssd1306_gray_cfg {
+	__u32 bpp;      /*! 2 or 4 bits per pixel, 0 turns grayscale off */
+	__u32 rate_hz;  /*! Sub-frames per second, 0 for panel refresh rate */
+};
+
+/**
+ * Whole screen gray frame, row-major, the first pixel in the most
+ * significant bits of a byte. Size is width * height * bpp / 8 bytes.
+ */
+struct ssd1306_gray_frame {
+	__u64 data;     /*! User pointer to the pixels */
+};
+
+struct ssd1306_gray_stats {
+	__u64 subframes;      /*! Sent sub-frames */
+	__u64 overruns;       /*! Sub-frames missed, bus was still busy */
+	__s64 jitter_max_ns;  /*! Worst delay of sub-frame start */
+	__s64 jitter_avg_ns;  /*! Average delay of sub-frame start */
+};
+
+#define SSD1306_IOC_SET_GRAY \
+	_IOW(SSD1306_IOC_MAGIC, 0x07, struct ssd1306_gray_cfg)
+#define SSD1306_IOC_GRAY_FRAME \
+	_IOW(SSD1306_IOC_MAGIC, 0x08, struct ssd1306_gray_frame)
+#define SSD1306_IOC_GET_GRAY_STATS \
+	_IOR(SSD1306_IOC_MAGIC, 0x09, struct ssd1306_gray_stats)
+
+/**
+ * Row-major 1bpp image (MSB first, rows padded to full byte) drawn into
+ * layer of the file. With zero width and height the data starts with
+ * binary PBM (P4) header.
+ */
+struct ssd1306_image {
+	__s32 x;        /*! Left column of the image */
+	__s32 y;        /*! Top row of the image */
+	__u32 width;    /*! Width in pixels, 0 to read PBM header */
+	__u32 height;   /*! Height in pixels, 0 to read PBM header */
+	__u64 data;     /*! User pointer to the image */
+	__u32 size;     /*! Size of the data in bytes */
+	__u32 flags;    /*! SSD1306_IMAGE_* flags */
+};
+
+#define SSD1306_IMAGE_CLEAR    0x1  /*! Clear the layer before drawing */
+
+#define SSD1306_IOC_IMAGE \
+	_IOW(SSD1306_IOC_MAGIC, 0x0A, struct ssd1306_image)
+
+/**
+ * ASCII string drawn into layer of the file with the default font scaled
+ * by integer factors. Glyph pixels are set, background is kept.
+ */
+struct ssd1306_text {
+	__s32 x;        /*! Left column of the text */
+	__s32 y;        /*! Top row of the text */
+	__u8 scale_x;   /*! Horizontal scale, 1 to 4 */
+	__u8 scale_y;   /*! Vertical scale, 1 to 4 */
+	__u16 flags;    /*! SSD1306_TEXT_* flags */
+	__u32 size;     /*! Length of the string */
+	__u64 data;     /*! User pointer to the string */
+};
+
+#define SSD1306_TEXT_CLEAR    0x1  /*! Clear the layer before drawing */
+
+#define SSD1306_IOC_TEXT \
+	_IOW(SSD1306_IOC_MAGIC, 0x0B, struct ssd1306_text)
+
+/**
+ * Attributes of a text line written to the file. Scaled line takes
+ * scale_y text lines of height and fits scale_x times less characters.
+ * Lines below are moved down. Attributes are reset by SSD1306_IOC_SET_LAYER.
+ * Cell writes to the columns past the visible characters of a scaled line
+ * fail with ENOSPC, text reaching them goes on to the next line.
+ */
+struct ssd1306_line_attr {
+	__u32 line;     /*! Text line, counted from zero */
+	__u8 scale_x;   /*! Horizontal scale, 1 to 4 */
+	__u8 scale_y;   /*! Vertical scale, 1 to 4 */
+	__u16 reserved;
+};
+
+#define SSD1306_IOC_SET_LINE_ATTR \
+	_IOW(SSD1306_IOC_MAGIC, 0x0C, struct ssd1306_line_attr)
+
+/**
+ * Effects driven by the kernel, every step is a single panel command
+ */
+enum ssd1306_effect_type {
+	SSD1306_EFFECT_NONE,    /*! Stop running effect */
+	SSD1306_EFFECT_FADE,    /*! Contrast ramp from, to over duration_ms */
+	SSD1306_EFFECT_BLINK,   /*! Display off and on, a blink per period_ms */
+	SSD1306_EFFECT_INVERT,  /*! Invert and back, a blink per period_ms */
+	SSD1306_EFFECT_FLASH,   /*! Single invert lasting duration_ms */
+};
+
+/**
+ * Progress of the contrast ramp in time
+ */
+enum ssd1306_easing {
+	SSD1306_EASE_LINEAR,
+	SSD1306_EASE_IN,        /*! Starts slowly */
+	SSD1306_EASE_OUT,       /*! Ends slowly */
+	SSD1306_EASE_IN_OUT,    /*! Starts and ends slowly */
+};
+
+struct ssd1306_effect {
+	__u32 type;         /*! enum ssd1306_effect_type */
+	__u32 easing;       /*! enum ssd1306_easing of the fade */
+	__u32 duration_ms;  /*! Length of the fade or the flash */
+	__u32 period_ms;    /*! Blink period, fade step or 0 for default */
+	__u32 count;        /*! Blinks before stopping, 0 runs until stopped */
+	__u8 from;          /*! Contrast at fade start */
+	__u8 to;            /*! Contrast at fade end, kept afterwards */
+	__u16 reserved;
+};
+
+#define SSD1306_IOC_EFFECT \
+	_IOW(SSD1306_IOC_MAGIC, 0x0D, struct ssd1306_effect)
+
+/**
+ * Whole canvas frame, row-major 1bpp (MSB first, rows padded to full byte)
+ * drawn into layer of the file. The call does not wait for the bus. Frame
+ * which was not sent yet is dropped and replaced by the newer one.
+ */
+struct ssd1306_frame {
+	__u64 data;     /*! User pointer to the rows */
+	__u32 size;     /*! Size of the data, width / 8 * height bytes */
+	__u32 reserved;
+};
+
+#define SSD1306_IOC_SUBMIT_FRAME \
+	_IOW(SSD1306_IOC_MAGIC, 0x0E, struct ssd1306_frame)
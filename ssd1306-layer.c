@@ -0,0 +1,332 @@
+// SPDX-License-Identifier: (GPL-2.0 OR MIT)
+
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+
+#include "ssd1306.h"
+#include "ssd1306-font.h"
+#include "ssd1306-cmode.h"
+#include "ssd1306-layer.h"
+#include "ssd1306-mailbox.h"
+
+/**
+ * @brief
+ *     Put the layer into display layers list keeping ascending z order.
+ *     Layer with the same z as others lands on top of them.
+ *
+ * @param[IN] layer    pointer to the layer
+ */
+static void ssd1306_layer_insert(struct ssd1306_layer *layer)
+{
+	struct ssd1306_layer *pos;
+
+	list_for_each_entry(pos, &layer->oled->layers, node) {
+		if (pos->z > layer->z) {
+			list_add_tail(&layer->node, &pos->node);
+			return;
+		}
+	}
+
+	list_add_tail(&layer->node, &layer->oled->layers);
+}
+
+/**
+ * @brief
+ *     Allocate full screen layer with z equal zero for new open file.
+ *     The layer is cleared and nothing is composed until the first draw.
+ *
+ * @param[IN] oled    pointer to SSD1306 main handle
+ *
+ * @return returns pointer to the layer or ERR_PTR
+ */
+struct ssd1306_layer *ssd1306_layer_create(struct ssd1306 *oled)
+{
+	struct ssd1306_layer *layer;
+	int err;
+
+	layer = kzalloc(sizeof(*layer), GFP_KERNEL);
+	if (!layer)
+		return ERR_PTR(-ENOMEM);
+
+	layer->buff = kzalloc(DISP_BUFF_SIZE, GFP_KERNEL);
+	if (!layer->buff) {
+		err = -ENOMEM;
+		goto err_layer;
+	}
+
+	layer->oled = oled;
+
+	mutex_lock(&oled->lock);
+
+	layer->width = ssd1306_width(oled);
+	layer->height = ssd1306_height(oled);
+
+	err = ssd1306_cmode_setup(&layer->cmode, DEFAULT_FONT_WIDTH,
+				  DEFAULT_FONT_HEIGHT, layer->width,
+				  layer->height);
+	if (err) {
+		mutex_unlock(&oled->lock);
+		goto err_buff;
+	}
+
+	ssd1306_layer_insert(layer);
+
+	mutex_unlock(&oled->lock);
+
+	return layer;
+
+err_buff:
+	kfree(layer->buff);
+err_layer:
+	kfree(layer);
+
+	return ERR_PTR(err);
+}
+
+/**
+ * @brief
+ *     Remove the layer. Its visible pixels are flattened into display base,
+ *     so the panel keeps showing them until somebody draws over. Layer
+ *     which was never drawn leaves the base as it is.
+ *
+ * @param[IN] layer    pointer to the layer
+ */
+void ssd1306_layer_destroy(struct ssd1306_layer *layer)
+{
+	struct ssd1306 *oled = layer->oled;
+	const int offset = DISP_BUFF_OFFSET;
+	const int width = ssd1306_width(oled);
+	const int pages = ssd1306_height(oled) / SSD1306_CELL_CAPACITY;
+	int page, col;
+
+	mutex_lock(&oled->lock);
+
+	for (page = 0; layer->drawn && page < pages; page++) {
+		const uint8_t mask = ssd1306_page_mask(page, layer->y,
+						layer->y + layer->height - 1);
+		uint8_t *base = &oled->base_buff[offset + page * width];
+		const uint8_t *pxl = &layer->buff[offset + page * width];
+
+		if (!mask)
+			continue;
+
+		for (col = layer->x; col < layer->x + layer->width; col++)
+			base[col] = (base[col] & ~mask) | (pxl[col] & mask);
+	}
+
+	list_del(&layer->node);
+
+	mutex_unlock(&oled->lock);
+
+	ssd1306_mailbox_free(layer->mailbox);
+	ssd1306_cmode_free(&layer->cmode);
+	kfree(layer->buff);
+	kfree(layer);
+}
+
+/**
+ * @brief
+ *     Move, resize or restack the layer. Layer content is cleared and both
+ *     old and new rectangles are composed again.
+ * @note
+ *     Caller has to hold oled->lock and send the changes with
+ *     ssd1306_display_dirty().
+ *
+ * @param[IN] layer     pointer to the layer
+ * @param[IN] x         left column
+ * @param[IN] y         top row
+ * @param[IN] width     width in pixels
+ * @param[IN] height    height in pixels
+ * @param[IN] z         stacking order
+ *
+ * @return returns zero or negative error
+ */
+int ssd1306_layer_set(struct ssd1306_layer *layer, int x, int y, int width,
+		      int height, int z)
+{
+	struct ssd1306_cmode cmode = { 0 };
+	int old_x, old_y, old_width, old_height;
+	int err;
+
+	if (width < SSD1306_LAYER_MIN_WIDTH ||
+	    height < SSD1306_LAYER_MIN_HEIGHT) {
+		LOG(KERN_DEBUG, "Layer %dx%d is smaller than %dx%d character",
+		    width, height, SSD1306_LAYER_MIN_WIDTH,
+		    SSD1306_LAYER_MIN_HEIGHT);
+		return -EINVAL;
+	}
+
+	if (x < 0 || y < 0 ||
+	    x + width > ssd1306_width(layer->oled) ||
+	    y + height > ssd1306_height(layer->oled)) {
+		LOG(KERN_DEBUG, "Layer %dx%d at %d,%d is out of the display",
+		    width, height, x, y);
+		return -EINVAL;
+	}
+
+	err = ssd1306_cmode_setup(&cmode, DEFAULT_FONT_WIDTH,
+				  DEFAULT_FONT_HEIGHT, width, height);
+	if (err)
+		return err;
+
+	ssd1306_cmode_free(&layer->cmode);
+	layer->cmode = cmode;
+
+	old_x = layer->x;
+	old_y = layer->y;
+	old_width = layer->width;
+	old_height = layer->height;
+
+	layer->x = x;
+	layer->y = y;
+	layer->width = width;
+	layer->height = height;
+	layer->z = z;
+
+	list_del(&layer->node);
+	ssd1306_layer_insert(layer);
+
+	ssd1306_layer_clear(layer);
+
+	ssd1306_compose(layer->oled, old_x, old_y, old_x + old_width - 1,
+			old_y + old_height - 1);
+	ssd1306_compose(layer->oled, x, y, x + width - 1, y + height - 1);
+
+	return 0;
+}
+
+/**
+ * @brief
+ *     Clear layer pixels. Display buffer is not touched.
+ *
+ * @param[IN] layer    pointer to the layer
+ */
+void ssd1306_layer_clear(struct ssd1306_layer *layer)
+{
+	memset(layer->buff, 0x00, DISP_BUFF_SIZE);
+	layer->buff[0] = SET_DISP_START_LINE;
+}
+
+/**
+ * @brief
+ *     Clear rectangle of layer pixels. Display buffer is not touched.
+ *
+ * @param[IN] layer    pointer to the layer
+ * @param[IN] x0       first column
+ * @param[IN] y0       first row
+ * @param[IN] x1       last column (inclusive)
+ * @param[IN] y1       last row (inclusive)
+ */
+void ssd1306_layer_clear_area(struct ssd1306_layer *layer, int x0, int y0,
+			      int x1, int y1)
+{
+	const int width = ssd1306_width(layer->oled);
+	int page;
+
+	for (page = y0 / SSD1306_CELL_CAPACITY;
+	     page <= y1 / SSD1306_CELL_CAPACITY; page++) {
+		const uint8_t mask = ssd1306_page_mask(page, y0, y1);
+		uint8_t *pxl = &layer->buff[DISP_BUFF_OFFSET + page * width];
+		int col;
+
+		for (col = x0; col <= x1; col++)
+			pxl[col] &= ~mask;
+	}
+}
+
+/**
+ * @brief
+ *     Compose rectangle of the layer into the display buffer after a draw
+ * @note
+ *     Caller has to hold oled->lock
+ *
+ * @param[IN] layer    pointer to the layer
+ */
+void ssd1306_layer_compose(struct ssd1306_layer *layer)
+{
+	layer->drawn = true;
+	ssd1306_compose(layer->oled, layer->x, layer->y,
+			layer->x + layer->width - 1,
+			layer->y + layer->height - 1);
+}
+
+/**
+ * @brief
+ *     Build the rectangle of the canvas from the base and all layers, from
+ *     the lowest z to the highest. Each page byte of a layer replaces bits
+ *     selected by its mask, layers never drawn are skipped. Changed columns
+ *     are marked dirty, transposed canvas is rotated into the display
+ *     buffer. Nothing is composed while grayscale mode owns the display
+ *     buffer, disabling it composes the whole canvas.
+ * @note
+ *     Caller has to hold oled->lock
+ *
+ * @param[IN] oled    pointer to SSD1306 main handle
+ * @param[IN] x0      first column
+ * @param[IN] y0      first row
+ * @param[IN] x1      last column (inclusive)
+ * @param[IN] y1      last row (inclusive)
+ */
+void ssd1306_compose(struct ssd1306 *oled, int x0, int y0, int x1, int y1)
+{
+	const int offset = DISP_BUFF_OFFSET;
+	struct ssd1306_layer *layer;
+	const bool transposed = ssd1306_transposed(oled);
+	uint8_t row[SSD1306_HORIZONTAL_MAX];
+	int page, col;
+
+	//Layers keep their content until grayscale mode is disabled
+	if (oled->gray)
+		return;
+
+	x0 = max(x0, 0);
+	y0 = max(y0, 0);
+	x1 = min(x1, ssd1306_width(oled) - 1);
+	y1 = min(y1, ssd1306_height(oled) - 1);
+
+	if (x0 > x1 || y0 > y1)
+		return;
+
+	for (page = y0 / SSD1306_CELL_CAPACITY;
+	     page <= y1 / SSD1306_CELL_CAPACITY; page++) {
+		const int base = offset + page * ssd1306_width(oled);
+		const uint8_t area = ssd1306_page_mask(page, y0, y1);
+		uint8_t *disp = &oled->canvas[base];
+
+		memcpy(&row[x0], &oled->base_buff[base + x0], x1 - x0 + 1);
+
+		list_for_each_entry(layer, &oled->layers, node) {
+			const uint8_t mask = ssd1306_page_mask(page, layer->y,
+						layer->y + layer->height - 1);
+			const int start = max(x0, layer->x);
+			const int end = min(x1, layer->x + layer->width - 1);
+			const uint8_t *pxl = &layer->buff[base];
+
+			if (!mask || !layer->drawn)
+				continue;
+
+			for (col = start; col <= end; col++)
+				row[col] = (row[col] & ~mask) |
+					   (pxl[col] & mask);
+		}
+
+		for (col = x0; col <= x1; col++) {
+			const uint8_t pxl = (disp[col] & ~area) |
+					    (row[col] & area);
+
+			if (pxl == disp[col])
+				continue;
+
+			disp[col] = pxl;
+			if (!transposed)
+				ssd1306_mark_dirty(oled, col,
+						   page * SSD1306_CELL_CAPACITY,
+						   col,
+						   page * SSD1306_CELL_CAPACITY);
+		}
+	}
+
+	if (transposed)
+		ssd1306_rotate_area(oled, x0, y0, x1, y1);
+}
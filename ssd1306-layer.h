@@ -0,0 +1,31 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+
+struct ssd1306_mailbox;
+
+//Layer fits at least one character with the space after it
+#define SSD1306_LAYER_MIN_WIDTH     (DEFAULT_FONT_WIDTH + 1)
+#define SSD1306_LAYER_MIN_HEIGHT    DEFAULT_FONT_HEIGHT
+
+struct ssd1306_layer {
+	struct list_head node;      /*! Entry of ssd1306 layers list */
+	struct ssd1306 *oled;       /*! Display owning the layer */
+	struct ssd1306_cmode cmode; /*! Text grid fitted to the layer */
+	int x;                      /*! Left column of the layer */
+	int y;                      /*! Top row of the layer */
+	int width;                  /*! Layer width in pixels */
+	int height;                 /*! Layer height in pixels */
+	int z;                      /*! Stacking order */
+	bool drawn;                 /*! Something was drawn into the layer */
+	uint8_t *buff;              /*! Pixels, laid out like disp_buff */
+	struct ssd1306_mailbox *mailbox; /*! Submitted frames, from the first */
+};
+
+struct ssd1306_layer *ssd1306_layer_create(struct ssd1306 *oled);
+void ssd1306_layer_destroy(struct ssd1306_layer *layer);
+int ssd1306_layer_set(struct ssd1306_layer *layer, int x, int y, int width,
+		      int height, int z);
+void ssd1306_layer_clear(struct ssd1306_layer *layer);
+void ssd1306_layer_clear_area(struct ssd1306_layer *layer, int x0, int y0,
+			      int x1, int y1);
+void ssd1306_layer_compose(struct ssd1306_layer *layer);
+void ssd1306_compose(struct ssd1306 *oled, int x0, int y0, int x1, int y1);
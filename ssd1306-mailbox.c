@@ -0,0 +1,208 @@
+// SPDX-License-Identifier: (GPL-2.0 OR MIT)
+
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/atomic.h>
+#include <linux/workqueue.h>
+
+#include "ssd1306.h"
+#include "ssd1306-layer.h"
+#include "ssd1306-image.h"
+#include "ssd1306-mailbox.h"
+
+/**
+ * Frame submission does not wait for the bus. Every file has three frame
+ * slots: producer fills the back one, the flush work shows the front one
+ * and the middle one is the last published frame. Producer and flush work
+ * swap their slot with the middle one by a single atomic exchange, so
+ * neither of them waits for the other. A published frame not taken before
+ * the next one is published is dropped, the panel shows at most one frame
+ * older than the newest.
+ */
+
+/**
+ * @brief
+ *     Allocate mailbox with empty slots
+ *
+ * @return returns pointer to the mailbox or NULL
+ */
+static struct ssd1306_mailbox *ssd1306_mailbox_alloc(void)
+{
+	struct ssd1306_mailbox *mb;
+	int i;
+
+	mb = kzalloc(sizeof(*mb), GFP_KERNEL);
+	if (!mb)
+		return NULL;
+
+	for (i = 0; i < SSD1306_MAILBOX_SLOTS; i++) {
+		mb->slot[i] = kzalloc(DISP_BUFF_SIZE, GFP_KERNEL);
+		if (!mb->slot[i])
+			goto err_free;
+	}
+
+	mb->rows = kmalloc(DISP_BUFF_SIZE, GFP_KERNEL);
+	if (!mb->rows)
+		goto err_free;
+
+	mb->back = 0;
+	atomic_set(&mb->middle, 1);
+	mb->front = 2;
+	mutex_init(&mb->lock);
+
+	return mb;
+
+err_free:
+	ssd1306_mailbox_free(mb);
+
+	return NULL;
+}
+
+/**
+ * @brief
+ *     Free the mailbox
+ *
+ * @param[IN] mb    pointer to the mailbox, can be NULL
+ */
+void ssd1306_mailbox_free(struct ssd1306_mailbox *mb)
+{
+	int i;
+
+	if (!mb)
+		return;
+
+	for (i = 0; i < SSD1306_MAILBOX_SLOTS; i++)
+		kfree(mb->slot[i]);
+
+	kfree(mb->rows);
+	kfree(mb);
+}
+
+/**
+ * @brief
+ *     Mailbox of the layer, allocated with the first frame. Text only
+ *     files don't pay for the slots.
+ *
+ * @param[IN] layer    pointer to the layer
+ *
+ * @return returns pointer to the mailbox or ERR_PTR
+ */
+struct ssd1306_mailbox *ssd1306_mailbox_get(struct ssd1306_layer *layer)
+{
+	struct ssd1306_mailbox *mb = smp_load_acquire(&layer->mailbox);
+	struct ssd1306_mailbox *old;
+
+	if (mb)
+		return mb;
+
+	mb = ssd1306_mailbox_alloc();
+	if (!mb)
+		return ERR_PTR(-ENOMEM);
+
+	//Other thread of the same file may have been faster
+	old = cmpxchg(&layer->mailbox, NULL, mb);
+	if (old) {
+		ssd1306_mailbox_free(mb);
+		return old;
+	}
+
+	return mb;
+}
+
+/**
+ * @brief
+ *     Convert rows of the mailbox into the back slot, publish it and kick
+ *     the flush work. Superseded frame is counted in frames_dropped.
+ * @note
+ *     Caller has to hold mb->lock, but not oled->lock
+ *
+ * @param[IN] layer    pointer to the layer
+ * @param[IN] mb       pointer to the mailbox of the layer
+ */
+void ssd1306_mailbox_publish(struct ssd1306_layer *layer,
+			     struct ssd1306_mailbox *mb)
+{
+	struct ssd1306 *oled = layer->oled;
+	int prev;
+
+	//Canvas geometry can't change while the file is open
+	ssd1306_image_blit(oled, mb->slot[mb->back], 0, 0, ssd1306_width(oled),
+			   ssd1306_height(oled), mb->rows);
+
+	prev = atomic_xchg(&mb->middle, mb->back | SSD1306_MAILBOX_FRESH);
+	mb->back = prev & SSD1306_MAILBOX_INDEX;
+
+	if (prev & SSD1306_MAILBOX_FRESH)
+		atomic64_inc(&oled->frames_dropped);
+
+	queue_work(system_highpri_wq, &oled->mailbox_work);
+}
+
+/**
+ * @brief
+ *     Take the newest published frame
+ * @note
+ *     Caller has to hold oled->lock
+ *
+ * @return returns the frame or NULL if nothing new was published
+ */
+static const uint8_t *ssd1306_mailbox_take(struct ssd1306_mailbox *mb)
+{
+	int prev;
+
+	if (!(atomic_read(&mb->middle) & SSD1306_MAILBOX_FRESH))
+		return NULL;
+
+	prev = atomic_xchg(&mb->middle, mb->front);
+	mb->front = prev & SSD1306_MAILBOX_INDEX;
+
+	return mb->slot[mb->front];
+}
+
+/**
+ * @brief
+ *     Flush side: draw the newest frame of every layer and send the changes
+ *     of all of them at once. Frames published during the transfer queue
+ *     the work again.
+ */
+void ssd1306_mailbox_work(struct work_struct *work)
+{
+	struct ssd1306 *oled = container_of(work, struct ssd1306,
+					    mailbox_work);
+	const int offset = DISP_BUFF_OFFSET;
+	struct ssd1306_layer *layer;
+	bool taken = false;
+	int err;
+
+	mutex_lock(&oled->lock);
+
+	list_for_each_entry(layer, &oled->layers, node) {
+		struct ssd1306_mailbox *mb = smp_load_acquire(&layer->mailbox);
+		const uint8_t *frame;
+
+		if (!mb)
+			continue;
+
+		frame = ssd1306_mailbox_take(mb);
+		if (!frame)
+			continue;
+
+		memcpy(&layer->buff[offset], &frame[offset],
+		       DISP_BUFF_SIZE - offset);
+		ssd1306_layer_compose(layer);
+		taken = true;
+	}
+
+	if (taken) {
+		err = ssd1306_display_dirty(oled);
+		if (err)
+			LOG(KERN_DEBUG, "Submitted frame transfer failed: %d",
+			    err);
+	}
+
+	mutex_unlock(&oled->lock);
+
+	//Unchanged frame is not sent, pollers wait for the empty mailbox
+	if (taken)
+		wake_up_interruptible_all(&oled->frame_wait);
+}
@@ -0,0 +1,21 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+
+#define SSD1306_MAILBOX_SLOTS    3
+//Published slot holds a frame the flush side didn't take yet
+#define SSD1306_MAILBOX_FRESH    0x4
+#define SSD1306_MAILBOX_INDEX    0x3
+
+struct ssd1306_mailbox {
+	uint8_t *slot[SSD1306_MAILBOX_SLOTS]; /*! Frames laid out like canvas */
+	int back;              /*! Slot owned by the producer */
+	atomic_t middle;       /*! Published slot, SSD1306_MAILBOX_FRESH flag */
+	int front;             /*! Slot owned by the flush side */
+	uint8_t *rows;         /*! Row-major frame copied from user space */
+	struct mutex lock;     /*! Serializes producers of the same file */
+};
+
+struct ssd1306_mailbox *ssd1306_mailbox_get(struct ssd1306_layer *layer);
+void ssd1306_mailbox_free(struct ssd1306_mailbox *mb);
+void ssd1306_mailbox_publish(struct ssd1306_layer *layer,
+			     struct ssd1306_mailbox *mb);
+void ssd1306_mailbox_work(struct work_struct *work);
@@ -0,0 +1,212 @@
+// SPDX-License-Identifier: (GPL-2.0 OR MIT)
+
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/workqueue.h>
+#include <linux/jiffies.h>
+
+#include "ssd1306.h"
+#include "ssd1306-orbit.h"
+
+/**
+ * Burn-in mitigation moves the whole image by a few pixels from time to
+ * time. Vertical steps only change the display start line, the image moves
+ * down over the blank RAM page below the panel. The controller can't move
+ * columns, so horizontal steps send the frame again to shifted columns.
+ * They are taken once per vertical cycle.
+ */
+
+/**
+ * @brief
+ *     Position on a back and forth path 0, 1, ... range, ... 1, 0, 1, ...
+ */
+static int ssd1306_orbit_pos(unsigned int step, int range)
+{
+	int pos;
+
+	if (!range)
+		return 0;
+
+	pos = step % (2 * range);
+
+	return pos <= range ? pos : 2 * range - pos;
+}
+
+/**
+ * @brief
+ *     Move the image to the given shift
+ * @note
+ *     Caller has to hold oled->lock
+ *
+ * @return returns zero or negative error
+ */
+static int ssd1306_orbit_move(struct ssd1306 *oled, int x, int y)
+{
+	int err;
+
+	err = ssd1306_set_start_line(oled, (SSD1306_RAM_ROWS - y) %
+					   SSD1306_RAM_ROWS);
+	if (err)
+		return err;
+
+	oled->shift_y = y;
+
+	if (oled->shift_x == x)
+		return 0;
+
+	//Whole image moves to other columns
+	oled->shift_x = x;
+	oled->sent_stale = true;
+
+	return ssd1306_display_dirty(oled);
+}
+
+static void ssd1306_orbit_work(struct work_struct *work)
+{
+	struct ssd1306_orbit *orbit = container_of(to_delayed_work(work),
+						   struct ssd1306_orbit, work);
+	struct ssd1306 *oled = orbit->oled;
+	int x, y;
+	int err;
+
+	mutex_lock(&oled->lock);
+
+	if (!orbit->period)
+		goto unlock;
+
+	orbit->step++;
+	y = ssd1306_orbit_pos(orbit->step, orbit->range_y);
+	x = ssd1306_orbit_pos(orbit->range_y ?
+			      orbit->step / (2 * orbit->range_y) : orbit->step,
+			      orbit->range_x);
+
+	err = ssd1306_orbit_move(oled, x, y);
+	if (err)
+		LOG(KERN_DEBUG, "Orbit step failed: %d", err);
+
+	schedule_delayed_work(&orbit->work, orbit->period * HZ);
+
+unlock:
+	mutex_unlock(&oled->lock);
+}
+
+/**
+ * @brief
+ *     Configure the orbit. Zero period stops it and moves the image back.
+ *
+ * @param[IN] oled       pointer to SSD1306 main handle
+ * @param[IN] period     seconds between steps
+ * @param[IN] range_x    maximal shift right in columns
+ * @param[IN] range_y    maximal shift down in rows
+ *
+ * @return returns zero or negative error
+ */
+int ssd1306_orbit_set(struct ssd1306 *oled, unsigned int period, int range_x,
+		      int range_y)
+{
+	struct ssd1306_orbit *orbit = oled->orbit;
+	int err = 0;
+
+	if (range_x < 0 || range_x > SSD1306_ORBIT_SHIFT_MAX ||
+	    range_y < 0 || range_y > SSD1306_ORBIT_SHIFT_MAX ||
+	    period > INT_MAX / HZ)
+		return -EINVAL;
+
+	mutex_lock(&oled->lock);
+
+	orbit->period = period;
+	orbit->range_x = range_x;
+	orbit->range_y = range_y;
+	orbit->step = 0;
+
+	/* The work re-checks the period under the lock, so it is enough to
+	 * cancel without waiting
+	 */
+	if (period) {
+		mod_delayed_work(system_wq, &orbit->work, period * HZ);
+	} else {
+		cancel_delayed_work(&orbit->work);
+		err = ssd1306_orbit_move(oled, 0, 0);
+	}
+
+	mutex_unlock(&oled->lock);
+
+	return err;
+}
+
+/**
+ * @brief
+ *     Hold the orbit for system sleep, the position is kept
+ *
+ * @param[IN] oled    pointer to SSD1306 main handle
+ */
+void ssd1306_orbit_suspend(struct ssd1306 *oled)
+{
+	if (!oled->orbit)
+		return;
+
+	cancel_delayed_work_sync(&oled->orbit->work);
+}
+
+/**
+ * @brief
+ *     Continue the orbit after system sleep
+ *
+ * @param[IN] oled    pointer to SSD1306 main handle
+ */
+void ssd1306_orbit_resume(struct ssd1306 *oled)
+{
+	struct ssd1306_orbit *orbit = oled->orbit;
+
+	if (!orbit)
+		return;
+
+	mutex_lock(&oled->lock);
+	if (orbit->period)
+		schedule_delayed_work(&orbit->work, orbit->period * HZ);
+	mutex_unlock(&oled->lock);
+}
+
+/**
+ * @brief
+ *     Allocate stopped orbit of the display
+ *
+ * @param[IN] oled    pointer to SSD1306 main handle
+ *
+ * @return returns zero or negative error
+ */
+int ssd1306_orbit_init(struct ssd1306 *oled)
+{
+	struct ssd1306_orbit *orbit;
+
+	orbit = kzalloc(sizeof(*orbit), GFP_KERNEL);
+	if (!orbit)
+		return -ENOMEM;
+
+	orbit->oled = oled;
+	INIT_DELAYED_WORK(&orbit->work, ssd1306_orbit_work);
+	oled->orbit = orbit;
+
+	return 0;
+}
+
+/**
+ * @brief
+ *     Stop the orbit and free it
+ *
+ * @param[IN] oled    pointer to SSD1306 main handle
+ */
+void ssd1306_orbit_exit(struct ssd1306 *oled)
+{
+	if (!oled->orbit)
+		return;
+
+	mutex_lock(&oled->lock);
+	oled->orbit->period = 0;
+	mutex_unlock(&oled->lock);
+
+	cancel_delayed_work_sync(&oled->orbit->work);
+
+	kfree(oled->orbit);
+	oled->orbit = NULL;
+}
@@ -0,0 +1,20 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+
+//Shift is limited to the single blank RAM page below the panel
+#define SSD1306_ORBIT_SHIFT_MAX    SSD1306_CELL_CAPACITY
+
+struct ssd1306_orbit {
+	struct ssd1306 *oled;
+	struct delayed_work work;  /*! Moves the image one step */
+	unsigned int period;       /*! Seconds between steps, 0 when stopped */
+	int range_x;               /*! Maximal shift right */
+	int range_y;               /*! Maximal shift down */
+	unsigned int step;         /*! Position on the orbit */
+};
+
+int ssd1306_orbit_init(struct ssd1306 *oled);
+void ssd1306_orbit_exit(struct ssd1306 *oled);
+void ssd1306_orbit_suspend(struct ssd1306 *oled);
+void ssd1306_orbit_resume(struct ssd1306 *oled);
+int ssd1306_orbit_set(struct ssd1306 *oled, unsigned int period, int range_x,
+		      int range_y);
@@ -0,0 +1,290 @@
+// SPDX-License-Identifier: (GPL-2.0 OR MIT)
+
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+
+#include "ssd1306.h"
+#include "ssd1306-ioctl.h"
+#include "ssd1306-sprite.h"
+
+/**
+ * @brief
+ *     Number of pages covered by the sprite shifted down by phase rows
+ */
+static inline int ssd1306_sprite_pages(int height, int phase)
+{
+	return DIV_ROUND_UP(height + phase, SSD1306_CELL_CAPACITY);
+}
+
+/**
+ * @brief
+ *     Store 1bpp bitmap in the device cache. The bitmap is converted once
+ *     into page format for every vertical phase, so drawing it at any row
+ *     is a plain copy of columns. Only the owner can draw and free it.
+ * @note
+ *     Caller must not hold oled->lock
+ *
+ * @param[IN] oled      pointer to SSD1306 main handle
+ * @param[IN] owner     layer of the uploading file
+ * @param[IN] width     bitmap width in pixels
+ * @param[IN] height    bitmap height in pixels
+ * @param[IN] rows      rows of the bitmap, MSB first, padded to full byte
+ *
+ * @return returns handle of the sprite or negative error
+ */
+int ssd1306_sprite_upload(struct ssd1306 *oled, struct ssd1306_layer *owner,
+			  int width, int height, const uint8_t *rows)
+{
+	const int stride = DIV_ROUND_UP(width, 8);
+	struct ssd1306_sprite *sprite;
+	uint8_t *data;
+	int size = 0;
+	int phase, row, col;
+	int handle;
+
+	if (!oled || !rows)
+		return -EPERM;
+
+	if (width <= 0 || height <= 0 || width > SSD1306_SPRITE_SIZE_MAX ||
+	    height > SSD1306_SPRITE_SIZE_MAX) {
+		LOG(KERN_DEBUG, "Sprite %dx%d is larger than the display",
+		    width, height);
+		return -EINVAL;
+	}
+
+	for (phase = 0; phase < SSD1306_SPRITE_PHASES; phase++)
+		size += width * ssd1306_sprite_pages(height, phase);
+
+	sprite = kzalloc(sizeof(*sprite), GFP_KERNEL);
+	data = kzalloc(size, GFP_KERNEL);
+	if (!sprite || !data) {
+		kfree(sprite);
+		kfree(data);
+		return -ENOMEM;
+	}
+
+	sprite->owner = owner;
+	sprite->width = width;
+	sprite->height = height;
+
+	for (phase = 0; phase < SSD1306_SPRITE_PHASES; phase++) {
+		sprite->phase[phase] = data;
+
+		for (row = 0; row < height; row++) {
+			const int y = row + phase;
+			uint8_t *dst = &data[(y / SSD1306_CELL_CAPACITY) * width];
+			const uint8_t bit = 1 << (y % SSD1306_CELL_CAPACITY);
+
+			for (col = 0; col < width; col++)
+				if (rows[row * stride + col / 8] &
+				    (0x80 >> (col % 8)))
+					dst[col] |= bit;
+		}
+
+		data += width * ssd1306_sprite_pages(height, phase);
+	}
+
+	mutex_lock(&oled->lock);
+	for (handle = 0; handle < SSD1306_SPRITES_MAX; handle++) {
+		if (!oled->sprites[handle]) {
+			oled->sprites[handle] = sprite;
+			break;
+		}
+	}
+	mutex_unlock(&oled->lock);
+
+	if (handle == SSD1306_SPRITES_MAX) {
+		LOG(KERN_DEBUG, "Sprite cache is full");
+		kfree(sprite->phase[0]);
+		kfree(sprite);
+		return -ENOSPC;
+	}
+
+	return handle;
+}
+
+/**
+ * @brief
+ *     Find the sprite of the owner, sprites of other files do not exist
+ *     for it
+ * @note
+ *     Caller has to hold oled->lock
+ *
+ * @return returns the sprite or NULL
+ */
+static struct ssd1306_sprite *ssd1306_sprite_get(struct ssd1306 *oled,
+						 struct ssd1306_layer *owner,
+						 int handle)
+{
+	struct ssd1306_sprite *sprite;
+
+	if (handle < 0 || handle >= SSD1306_SPRITES_MAX)
+		return NULL;
+
+	sprite = oled->sprites[handle];
+	if (!sprite || sprite->owner != owner)
+		return NULL;
+
+	return sprite;
+}
+
+/**
+ * @brief
+ *     Drop the sprite from its slot and free it
+ * @note
+ *     Caller has to hold oled->lock
+ */
+static void ssd1306_sprite_remove(struct ssd1306 *oled, int handle)
+{
+	struct ssd1306_sprite *sprite = oled->sprites[handle];
+
+	oled->sprites[handle] = NULL;
+
+	//All phases live in the single allocation
+	kfree(sprite->phase[0]);
+	kfree(sprite);
+}
+
+/**
+ * @brief
+ *     Remove the sprite from the device cache
+ * @note
+ *     Caller has to hold oled->lock
+ *
+ * @param[IN] oled      pointer to SSD1306 main handle
+ * @param[IN] owner     layer of the file freeing the sprite
+ * @param[IN] handle    sprite handle
+ *
+ * @return returns zero or negative error
+ */
+int ssd1306_sprite_free(struct ssd1306 *oled, struct ssd1306_layer *owner,
+			int handle)
+{
+	if (handle < 0 || handle >= SSD1306_SPRITES_MAX)
+		return -EINVAL;
+
+	if (!ssd1306_sprite_get(oled, owner, handle))
+		return -ENOENT;
+
+	ssd1306_sprite_remove(oled, handle);
+
+	return 0;
+}
+
+/**
+ * @brief
+ *     Remove all sprites of the closed file from the device cache
+ * @note
+ *     Caller has to hold oled->lock
+ *
+ * @param[IN] oled     pointer to SSD1306 main handle
+ * @param[IN] owner    layer of the closed file
+ */
+void ssd1306_sprite_release(struct ssd1306 *oled, struct ssd1306_layer *owner)
+{
+	int handle;
+
+	for (handle = 0; handle < SSD1306_SPRITES_MAX; handle++)
+		if (ssd1306_sprite_get(oled, owner, handle))
+			ssd1306_sprite_remove(oled, handle);
+}
+
+/**
+ * @brief
+ *     Remove all sprites from the device cache
+ *
+ * @param[IN] oled    pointer to SSD1306 main handle
+ */
+void ssd1306_sprite_free_all(struct ssd1306 *oled)
+{
+	int handle;
+
+	for (handle = 0; handle < SSD1306_SPRITES_MAX; handle++)
+		if (oled->sprites[handle])
+			ssd1306_sprite_remove(oled, handle);
+}
+
+/**
+ * @brief
+ *     Draw cached sprite into any buffer laid out like the canvas. Parts out
+ *     of the canvas are clipped.
+ * @note
+ *     Caller has to hold oled->lock
+ *
+ * @param[IN] oled      pointer to SSD1306 main handle
+ * @param[IN] owner     layer of the drawing file
+ * @param[IN] buff      pointer to the page buffer
+ * @param[IN] handle    sprite handle
+ * @param[IN] x         left column
+ * @param[IN] y         top row
+ * @param[IN] rop       one of SSD1306_ROP_* operations
+ *
+ * @return returns zero or negative error
+ */
+int ssd1306_sprite_draw(struct ssd1306 *oled, struct ssd1306_layer *owner,
+			uint8_t *buff, int handle, int x, int y, int rop)
+{
+	const int offset = DISP_BUFF_OFFSET;
+	struct ssd1306_sprite *sprite;
+	int phase, pages, page, first_page;
+	int start, end, col;
+
+	if (!oled || !buff)
+		return -EPERM;
+
+	sprite = ssd1306_sprite_get(oled, owner, handle);
+	if (!sprite)
+		return -ENOENT;
+
+	if (rop < SSD1306_ROP_COPY || rop > SSD1306_ROP_XOR)
+		return -EINVAL;
+
+	//Floor division, the sprite can start above the display
+	phase = ((y % SSD1306_CELL_CAPACITY) + SSD1306_CELL_CAPACITY) %
+		SSD1306_CELL_CAPACITY;
+	first_page = (y - phase) / SSD1306_CELL_CAPACITY;
+	pages = ssd1306_sprite_pages(sprite->height, phase);
+
+	start = max(0, -x);
+	end = min(sprite->width, ssd1306_width(oled) - x);
+	if (start >= end)
+		return 0;
+
+	for (page = 0; page < pages; page++) {
+		const uint8_t *src = &sprite->phase[phase][page * sprite->width +
+							   start];
+		const uint8_t mask = ssd1306_page_mask(page, phase,
+						phase + sprite->height - 1);
+		uint8_t *dst;
+
+		if (first_page + page < 0 ||
+		    (first_page + page) * SSD1306_CELL_CAPACITY >=
+		    ssd1306_height(oled))
+			continue;
+
+		dst = &buff[offset + (first_page + page) * ssd1306_width(oled) +
+			    x + start];
+
+		switch (rop) {
+		case SSD1306_ROP_COPY:
+			for (col = 0; col < end - start; col++)
+				dst[col] = (dst[col] & ~mask) | src[col];
+			break;
+		case SSD1306_ROP_OR:
+			for (col = 0; col < end - start; col++)
+				dst[col] |= src[col];
+			break;
+		case SSD1306_ROP_CLEAR:
+			for (col = 0; col < end - start; col++)
+				dst[col] &= ~src[col];
+			break;
+		case SSD1306_ROP_XOR:
+			for (col = 0; col < end - start; col++)
+				dst[col] ^= src[col];
+			break;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,25 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+
+#define SSD1306_SPRITE_PHASES    SSD1306_CELL_CAPACITY
+//Sprite fits the canvas in any rotation
+#define SSD1306_SPRITE_SIZE_MAX \
+	max(SSD1306_HORIZONTAL_MAX, SSD1306_VERTICAL_MAX)
+
+struct ssd1306_layer;
+
+struct ssd1306_sprite {
+	struct ssd1306_layer *owner; /*! Layer of the file which uploaded it */
+	int width;        /*! Width in pixels */
+	int height;       /*! Height in pixels */
+	/*! Bitmap shifted down by 0..7 rows, in page format, width * pages */
+	uint8_t *phase[SSD1306_SPRITE_PHASES];
+};
+
+int ssd1306_sprite_upload(struct ssd1306 *oled, struct ssd1306_layer *owner,
+			  int width, int height, const uint8_t *rows);
+int ssd1306_sprite_free(struct ssd1306 *oled, struct ssd1306_layer *owner,
+			int handle);
+void ssd1306_sprite_release(struct ssd1306 *oled, struct ssd1306_layer *owner);
+void ssd1306_sprite_free_all(struct ssd1306 *oled);
+int ssd1306_sprite_draw(struct ssd1306 *oled, struct ssd1306_layer *owner,
+			uint8_t *buff, int handle, int x, int y, int rop);
@@ -0,0 +1,533 @@
+// SPDX-License-Identifier: (GPL-2.0 OR MIT)
+
+#include <linux/kernel.h>
+#include <linux/device.h>
+#include <linux/workqueue.h>
+#include <linux/hrtimer.h>
+#include <linux/string.h>
+
+#include "ssd1306.h"
+#include "ssd1306-sysfs.h"
+#include "ssd1306-tile.h"
+#include "ssd1306-orbit.h"
+#include "ssd1306-ioctl.h"
+#include "ssd1306-effect.h"
+
+/**
+ * Attributes of /sys/class/oled/ssd1306*
+ */
+
+static const char * const ssd1306_effect_names[] = {
+	[SSD1306_EFFECT_NONE] = "none",
+	[SSD1306_EFFECT_FADE] = "fade",
+	[SSD1306_EFFECT_BLINK] = "blink",
+	[SSD1306_EFFECT_INVERT] = "invert",
+	[SSD1306_EFFECT_FLASH] = "flash",
+};
+
+static const char * const ssd1306_easing_names[] = {
+	[SSD1306_EASE_LINEAR] = "linear",
+	[SSD1306_EASE_IN] = "in",
+	[SSD1306_EASE_OUT] = "out",
+	[SSD1306_EASE_IN_OUT] = "in-out",
+};
+
+/**
+ * @brief
+ *     Apply orientation and send the whole frame again
+ *
+ * @return returns zero or negative error
+ */
+static int ssd1306_sysfs_orientation(struct ssd1306 *oled, int rotation,
+				     bool mirror_x, bool mirror_y)
+{
+	int err;
+
+	mutex_lock(&oled->lock);
+
+	err = ssd1306_set_orientation(oled, rotation, mirror_x, mirror_y);
+	if (!err)
+		err = ssd1306_display_dirty(oled);
+
+	mutex_unlock(&oled->lock);
+
+	return err;
+}
+
+static ssize_t rotation_show(struct device *dev,
+			     struct device_attribute *attr, char *buf)
+{
+	struct ssd1306 *oled = dev_get_drvdata(dev);
+
+	return sprintf(buf, "%d\n", oled->rotation);
+}
+
+static ssize_t rotation_store(struct device *dev,
+			      struct device_attribute *attr,
+			      const char *buf, size_t count)
+{
+	struct ssd1306 *oled = dev_get_drvdata(dev);
+	int rotation;
+	int err;
+
+	err = kstrtoint(buf, 10, &rotation);
+	if (err)
+		return err;
+
+	err = ssd1306_sysfs_orientation(oled, rotation, oled->mirror_x,
+					oled->mirror_y);
+
+	return err ? err : count;
+}
+static DEVICE_ATTR_RW(rotation);
+
+static ssize_t mirror_x_show(struct device *dev,
+			     struct device_attribute *attr, char *buf)
+{
+	struct ssd1306 *oled = dev_get_drvdata(dev);
+
+	return sprintf(buf, "%d\n", oled->mirror_x);
+}
+
+static ssize_t mirror_x_store(struct device *dev,
+			      struct device_attribute *attr,
+			      const char *buf, size_t count)
+{
+	struct ssd1306 *oled = dev_get_drvdata(dev);
+	bool mirror;
+	int err;
+
+	err = kstrtobool(buf, &mirror);
+	if (err)
+		return err;
+
+	err = ssd1306_sysfs_orientation(oled, oled->rotation, mirror,
+					oled->mirror_y);
+
+	return err ? err : count;
+}
+static DEVICE_ATTR_RW(mirror_x);
+
+static ssize_t mirror_y_show(struct device *dev,
+			     struct device_attribute *attr, char *buf)
+{
+	struct ssd1306 *oled = dev_get_drvdata(dev);
+
+	return sprintf(buf, "%d\n", oled->mirror_y);
+}
+
+static ssize_t mirror_y_store(struct device *dev,
+			      struct device_attribute *attr,
+			      const char *buf, size_t count)
+{
+	struct ssd1306 *oled = dev_get_drvdata(dev);
+	bool mirror;
+	int err;
+
+	err = kstrtobool(buf, &mirror);
+	if (err)
+		return err;
+
+	err = ssd1306_sysfs_orientation(oled, oled->rotation, oled->mirror_x,
+					mirror);
+
+	return err ? err : count;
+}
+static DEVICE_ATTR_RW(mirror_y);
+
+static ssize_t tile_index_show(struct device *dev,
+			       struct device_attribute *attr, char *buf)
+{
+	struct ssd1306 *oled = dev_get_drvdata(dev);
+
+	return sprintf(buf, "%d\n", READ_ONCE(oled->tile_index));
+}
+
+static ssize_t tile_index_store(struct device *dev,
+				struct device_attribute *attr,
+				const char *buf, size_t count)
+{
+	struct ssd1306 *oled = dev_get_drvdata(dev);
+	int index;
+	int err;
+
+	err = kstrtoint(buf, 10, &index);
+	if (err)
+		return err;
+
+	err = ssd1306_tile_set(oled, index);
+
+	return err ? err : count;
+}
+static DEVICE_ATTR_RW(tile_index);
+
+static ssize_t orbit_period_show(struct device *dev,
+				 struct device_attribute *attr, char *buf)
+{
+	struct ssd1306 *oled = dev_get_drvdata(dev);
+
+	return sprintf(buf, "%u\n", oled->orbit->period);
+}
+
+static ssize_t orbit_period_store(struct device *dev,
+				  struct device_attribute *attr,
+				  const char *buf, size_t count)
+{
+	struct ssd1306 *oled = dev_get_drvdata(dev);
+	unsigned int period;
+	int err;
+
+	err = kstrtouint(buf, 10, &period);
+	if (err)
+		return err;
+
+	err = ssd1306_orbit_set(oled, period, oled->orbit->range_x,
+				oled->orbit->range_y);
+
+	return err ? err : count;
+}
+static DEVICE_ATTR_RW(orbit_period);
+
+static ssize_t orbit_x_show(struct device *dev,
+			    struct device_attribute *attr, char *buf)
+{
+	struct ssd1306 *oled = dev_get_drvdata(dev);
+
+	return sprintf(buf, "%d\n", oled->orbit->range_x);
+}
+
+static ssize_t orbit_x_store(struct device *dev,
+			     struct device_attribute *attr,
+			     const char *buf, size_t count)
+{
+	struct ssd1306 *oled = dev_get_drvdata(dev);
+	int range;
+	int err;
+
+	err = kstrtoint(buf, 10, &range);
+	if (err)
+		return err;
+
+	err = ssd1306_orbit_set(oled, oled->orbit->period, range,
+				oled->orbit->range_y);
+
+	return err ? err : count;
+}
+static DEVICE_ATTR_RW(orbit_x);
+
+static ssize_t orbit_y_show(struct device *dev,
+			    struct device_attribute *attr, char *buf)
+{
+	struct ssd1306 *oled = dev_get_drvdata(dev);
+
+	return sprintf(buf, "%d\n", oled->orbit->range_y);
+}
+
+static ssize_t orbit_y_store(struct device *dev,
+			     struct device_attribute *attr,
+			     const char *buf, size_t count)
+{
+	struct ssd1306 *oled = dev_get_drvdata(dev);
+	int range;
+	int err;
+
+	err = kstrtoint(buf, 10, &range);
+	if (err)
+		return err;
+
+	err = ssd1306_orbit_set(oled, oled->orbit->period,
+				oled->orbit->range_x, range);
+
+	return err ? err : count;
+}
+static DEVICE_ATTR_RW(orbit_y);
+
+static ssize_t contrast_show(struct device *dev,
+			     struct device_attribute *attr, char *buf)
+{
+	struct ssd1306 *oled = dev_get_drvdata(dev);
+
+	return sprintf(buf, "%u\n", READ_ONCE(oled->contrast));
+}
+
+static ssize_t contrast_store(struct device *dev,
+			      struct device_attribute *attr,
+			      const char *buf, size_t count)
+{
+	struct ssd1306 *oled = dev_get_drvdata(dev);
+	u8 contrast;
+	int err;
+
+	err = kstrtou8(buf, 10, &contrast);
+	if (err)
+		return err;
+
+	err = ssd1306_effect_contrast(oled, contrast);
+
+	return err ? err : count;
+}
+static DEVICE_ATTR_RW(contrast);
+
+static ssize_t effect_show(struct device *dev,
+			   struct device_attribute *attr, char *buf)
+{
+	struct ssd1306 *oled = dev_get_drvdata(dev);
+	int type;
+
+	mutex_lock(&oled->lock);
+	type = oled->effects->running ? oled->effects->type :
+					SSD1306_EFFECT_NONE;
+	mutex_unlock(&oled->lock);
+
+	return sprintf(buf, "%s\n", ssd1306_effect_names[type]);
+}
+
+/**
+ * Accepts the same parameters as SSD1306_IOC_EFFECT:
+ *     fade <from> <to> <duration_ms> [easing]
+ *     blink <period_ms> [count]
+ *     invert <period_ms> [count]
+ *     flash <duration_ms>
+ *     none
+ */
+static ssize_t effect_store(struct device *dev,
+			    struct device_attribute *attr,
+			    const char *buf, size_t count)
+{
+	struct ssd1306 *oled = dev_get_drvdata(dev);
+	struct ssd1306_effect effect;
+	char name[8];
+	char easing[8] = "linear";
+	unsigned int arg[3] = { 0 };
+	int args;
+	int err;
+
+	args = sscanf(buf, "%7s %u %u %u %7s", name, &arg[0], &arg[1],
+		      &arg[2], easing) - 1;
+	if (args < 0)
+		return -EINVAL;
+
+	memset(&effect, 0, sizeof(effect));
+
+	err = match_string(ssd1306_effect_names,
+			   ARRAY_SIZE(ssd1306_effect_names), name);
+	if (err < 0)
+		return err;
+	effect.type = err;
+
+	switch (effect.type) {
+	case SSD1306_EFFECT_FADE:
+		if (args < 3 || arg[0] > 0xFF || arg[1] > 0xFF)
+			return -EINVAL;
+
+		err = match_string(ssd1306_easing_names,
+				   ARRAY_SIZE(ssd1306_easing_names), easing);
+		if (err < 0)
+			return err;
+
+		effect.from = arg[0];
+		effect.to = arg[1];
+		effect.duration_ms = arg[2];
+		effect.easing = err;
+		break;
+
+	case SSD1306_EFFECT_BLINK:
+	case SSD1306_EFFECT_INVERT:
+		if (args < 1)
+			return -EINVAL;
+
+		effect.period_ms = arg[0];
+		effect.count = arg[1];
+		break;
+
+	case SSD1306_EFFECT_FLASH:
+		if (args < 1)
+			return -EINVAL;
+
+		effect.duration_ms = arg[0];
+		break;
+	}
+
+	err = ssd1306_effect_start(oled, &effect);
+
+	return err ? err : count;
+}
+static DEVICE_ATTR_RW(effect);
+
+static ssize_t clock_divide_show(struct device *dev,
+				 struct device_attribute *attr, char *buf)
+{
+	struct ssd1306 *oled = dev_get_drvdata(dev);
+
+	return sprintf(buf, "%u\n", (READ_ONCE(oled->clock) & 0x0F) + 1);
+}
+
+static ssize_t clock_divide_store(struct device *dev,
+				  struct device_attribute *attr,
+				  const char *buf, size_t count)
+{
+	struct ssd1306 *oled = dev_get_drvdata(dev);
+	unsigned int divide;
+	int err;
+
+	err = kstrtouint(buf, 10, &divide);
+	if (err)
+		return err;
+
+	if (divide < 1 || divide > 16)
+		return -EINVAL;
+
+	mutex_lock(&oled->lock);
+	err = ssd1306_set_timing(oled, (oled->clock & 0xF0) | (divide - 1),
+				 oled->precharge, oled->vcomh);
+	mutex_unlock(&oled->lock);
+
+	return err ? err : count;
+}
+static DEVICE_ATTR_RW(clock_divide);
+
+static ssize_t osc_freq_show(struct device *dev,
+			     struct device_attribute *attr, char *buf)
+{
+	struct ssd1306 *oled = dev_get_drvdata(dev);
+
+	return sprintf(buf, "%u\n", READ_ONCE(oled->clock) >> 4);
+}
+
+static ssize_t osc_freq_store(struct device *dev,
+			      struct device_attribute *attr,
+			      const char *buf, size_t count)
+{
+	struct ssd1306 *oled = dev_get_drvdata(dev);
+	unsigned int freq;
+	int err;
+
+	err = kstrtouint(buf, 10, &freq);
+	if (err)
+		return err;
+
+	if (freq > 15)
+		return -EINVAL;
+
+	mutex_lock(&oled->lock);
+	err = ssd1306_set_timing(oled, (oled->clock & 0x0F) | freq << 4,
+				 oled->precharge, oled->vcomh);
+	mutex_unlock(&oled->lock);
+
+	return err ? err : count;
+}
+static DEVICE_ATTR_RW(osc_freq);
+
+static ssize_t precharge_show(struct device *dev,
+			      struct device_attribute *attr, char *buf)
+{
+	struct ssd1306 *oled = dev_get_drvdata(dev);
+	const uint8_t precharge = READ_ONCE(oled->precharge);
+
+	return sprintf(buf, "%u %u\n", precharge & 0x0F, precharge >> 4);
+}
+
+/**
+ * Phase 1 and phase 2 periods in DCLKs, 1 to 15 each, e.g. "2 2"
+ */
+static ssize_t precharge_store(struct device *dev,
+			       struct device_attribute *attr,
+			       const char *buf, size_t count)
+{
+	struct ssd1306 *oled = dev_get_drvdata(dev);
+	unsigned int phase1, phase2;
+	int err;
+
+	if (sscanf(buf, "%u %u", &phase1, &phase2) != 2)
+		return -EINVAL;
+
+	if (phase1 < 1 || phase1 > 15 || phase2 < 1 || phase2 > 15)
+		return -EINVAL;
+
+	mutex_lock(&oled->lock);
+	err = ssd1306_set_timing(oled, oled->clock, phase2 << 4 | phase1,
+				 oled->vcomh);
+	mutex_unlock(&oled->lock);
+
+	return err ? err : count;
+}
+static DEVICE_ATTR_RW(precharge);
+
+static ssize_t vcomh_show(struct device *dev,
+			  struct device_attribute *attr, char *buf)
+{
+	struct ssd1306 *oled = dev_get_drvdata(dev);
+
+	return sprintf(buf, "0x%02x\n", READ_ONCE(oled->vcomh));
+}
+
+static ssize_t vcomh_store(struct device *dev,
+			   struct device_attribute *attr,
+			   const char *buf, size_t count)
+{
+	struct ssd1306 *oled = dev_get_drvdata(dev);
+	u8 vcomh;
+	int err;
+
+	err = kstrtou8(buf, 0, &vcomh);
+	if (err)
+		return err;
+
+	mutex_lock(&oled->lock);
+	err = ssd1306_set_timing(oled, oled->clock, oled->precharge, vcomh);
+	mutex_unlock(&oled->lock);
+
+	return err ? err : count;
+}
+static DEVICE_ATTR_RW(vcomh);
+
+static ssize_t refresh_rate_show(struct device *dev,
+				 struct device_attribute *attr, char *buf)
+{
+	struct ssd1306 *oled = dev_get_drvdata(dev);
+	int rate;
+
+	mutex_lock(&oled->lock);
+	rate = ssd1306_refresh_rate(oled);
+	mutex_unlock(&oled->lock);
+
+	return sprintf(buf, "%d\n", rate);
+}
+static DEVICE_ATTR_RO(refresh_rate);
+
+static ssize_t frames_dropped_show(struct device *dev,
+				   struct device_attribute *attr, char *buf)
+{
+	struct ssd1306 *oled = dev_get_drvdata(dev);
+
+	return sprintf(buf, "%lld\n", atomic64_read(&oled->frames_dropped));
+}
+static DEVICE_ATTR_RO(frames_dropped);
+
+static struct attribute *ssd1306_attrs[] = {
+	&dev_attr_rotation.attr,
+	&dev_attr_mirror_x.attr,
+	&dev_attr_mirror_y.attr,
+	&dev_attr_tile_index.attr,
+	&dev_attr_orbit_period.attr,
+	&dev_attr_orbit_x.attr,
+	&dev_attr_orbit_y.attr,
+	&dev_attr_contrast.attr,
+	&dev_attr_effect.attr,
+	&dev_attr_clock_divide.attr,
+	&dev_attr_osc_freq.attr,
+	&dev_attr_precharge.attr,
+	&dev_attr_vcomh.attr,
+	&dev_attr_refresh_rate.attr,
+	&dev_attr_frames_dropped.attr,
+	NULL,
+};
+
+static const struct attribute_group ssd1306_group = {
+	.attrs = ssd1306_attrs,
+};
+
+const struct attribute_group *ssd1306_groups[] = {
+	&ssd1306_group,
+	NULL,
+};
@@ -0,0 +1,3 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+
+extern const struct attribute_group *ssd1306_groups[];
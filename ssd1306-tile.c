@@ -0,0 +1,559 @@
+// SPDX-License-Identifier: (GPL-2.0 OR MIT)
+
+#include <linux/kernel.h>
+#include <linux/fs.h>
+#include <linux/cdev.h>
+#include <linux/device.h>
+#include <linux/font.h>
+#include <linux/slab.h>
+#include <linux/uaccess.h>
+#include <linux/workqueue.h>
+
+#include "ssd1306.h"
+#include "ssd1306-font.h"
+#include "ssd1306-cmode.h"
+#include "ssd1306-layer.h"
+#include "ssd1306-image.h"
+#include "ssd1306-ioctl.h"
+#include "ssd1306-tile.h"
+
+/**
+ * Tiled canvas joins panels side by side in order of their tile index into
+ * one surface, /dev/ssd1306-tile. Text and images are drawn into row-major
+ * 1bpp surface of the open file. Every panel gets its columns through its
+ * own full screen layer, panels are rendered and flushed in parallel on
+ * their own adapters.
+ */
+
+struct ssd1306_tile_panel {
+	struct ssd1306 *oled;         /*! Panel, NULL after it was removed */
+	struct ssd1306_layer *layer;  /*! Layer of the file on the panel */
+	struct work_struct work;      /*! Renders and flushes the panel */
+	uint8_t *rows;                /*! Panel columns of the surface */
+	int x;                        /*! First surface column of the panel */
+	int width;                    /*! Columns of the panel */
+	int err;                      /*! Result of the last flush */
+};
+
+struct ssd1306_tile_file {
+	struct list_head node;
+	struct ssd1306_tile_panel panels[SSD1306_TILE_MAX];
+	int count;                    /*! Panels of the surface */
+	int width;                    /*! Sum of the panels width */
+	int height;                   /*! Common height of the panels */
+	int stride;                   /*! Bytes of a surface row */
+	uint8_t *surface;             /*! Row-major 1bpp, MSB first */
+	struct ssd1306_cmode cmode;
+};
+
+static struct {
+	struct cdev char_dev;
+	struct class *class;
+	struct mutex lock;            /*! Protects panels and open files */
+	struct ssd1306 *panels[SSD1306_TILE_MAX];
+	struct list_head files;       /*! Open files of the tile device */
+} ssd1306_tile;
+
+/**
+ * @brief
+ *     Copy the panel columns into the panel layer, compose and send them.
+ *     Runs on unbound workqueue, so panels on different adapters transfer
+ *     at the same time.
+ */
+static void ssd1306_tile_work(struct work_struct *work)
+{
+	struct ssd1306_tile_panel *panel =
+		container_of(work, struct ssd1306_tile_panel, work);
+	struct ssd1306 *oled = panel->oled;
+
+	mutex_lock(&oled->lock);
+
+	ssd1306_image_blit(oled, panel->layer->buff, 0, 0, ssd1306_width(oled),
+			   ssd1306_height(oled), panel->rows);
+	ssd1306_layer_compose(panel->layer);
+	panel->err = ssd1306_display_dirty(oled);
+
+	mutex_unlock(&oled->lock);
+}
+
+/**
+ * @brief
+ *     Send surface columns x0..x1 to the panels covering them and wait
+ *     until every panel is done.
+ * @note
+ *     Caller has to hold ssd1306_tile.lock
+ *
+ * @return returns zero or error of any panel
+ */
+static int ssd1306_tile_flush(struct ssd1306_tile_file *file, int x0, int x1)
+{
+	struct ssd1306_tile_panel *panel;
+	int i, row;
+	int err = 0;
+
+	for (i = 0; i < file->count; i++) {
+		panel = &file->panels[i];
+		panel->err = 0;
+
+		if (!panel->oled || x1 < panel->x ||
+		    x0 >= panel->x + panel->width)
+			continue;
+
+		for (row = 0; row < file->height; row++)
+			memcpy(&panel->rows[row * panel->width / 8],
+			       &file->surface[row * file->stride + panel->x / 8],
+			       panel->width / 8);
+
+		queue_work(system_unbound_wq, &panel->work);
+	}
+
+	for (i = 0; i < file->count; i++) {
+		panel = &file->panels[i];
+
+		flush_work(&panel->work);
+		if (panel->err)
+			err = panel->err;
+	}
+
+	return err;
+}
+
+/**
+ * @brief
+ *     Print a line of text into the surface using default kernel font
+ *
+ * @param[IN] file    tile file
+ * @param[IN] y       top row of the line
+ * @param[IN] str     ASCII string
+ */
+static void ssd1306_tile_print(struct ssd1306_tile_file *file, int y,
+			       const char *str)
+{
+	const struct font_desc *font;
+	const uint8_t *glyph;
+	uint8_t *dst;
+	int x, row;
+
+	font = get_default_font(SSD1306_HORIZONTAL_MAX, SSD1306_VERTICAL_MAX,
+				DEFAULT_FONT_WIDTH, DEFAULT_FONT_HEIGHT);
+	if (!font || !str)
+		return;
+
+	//Font is 8 pixels wide, so a glyph row spans at most two bytes
+	for (x = 0; *str && x + font->width <= file->width;
+	     str++, x += font->width + 1) {
+		glyph = (uint8_t *)font->data + (uint8_t)*str * font->height;
+
+		for (row = 0; row < font->height && y + row < file->height;
+		     row++) {
+			dst = &file->surface[(y + row) * file->stride + x / 8];
+			dst[0] |= glyph[row] >> (x % 8);
+			if (x % 8)
+				dst[1] |= glyph[row] << (8 - x % 8);
+		}
+	}
+}
+
+/**
+ * @brief
+ *     Copy row-major 1bpp image into the surface, parts out of the surface
+ *     are clipped.
+ *
+ * @return returns last surface column changed by the image
+ */
+static int ssd1306_tile_blit(struct ssd1306_tile_file *file, int x, int y,
+			     int width, int height, const uint8_t *rows)
+{
+	const int stride = DIV_ROUND_UP(width, 8);
+	int row, col;
+
+	width = min(width, file->width - x);
+	height = min(height, file->height - y);
+
+	for (row = 0; row < height; row++) {
+		uint8_t *dst = &file->surface[(y + row) * file->stride];
+
+		for (col = 0; col < width; col += 8) {
+			const int pos = x + col;
+			const int shift = pos % 8;
+			const uint8_t mask = 0xFF << (8 - min(8, width - col));
+			const uint8_t pxls = rows[row * stride + col / 8] & mask;
+
+			dst[pos / 8] = (dst[pos / 8] & ~(mask >> shift)) |
+				       (pxls >> shift);
+			if (shift && pos / 8 + 1 < file->stride)
+				dst[pos / 8 + 1] = (dst[pos / 8 + 1] &
+					~(uint8_t)(mask << (8 - shift))) |
+					(uint8_t)(pxls << (8 - shift));
+		}
+	}
+
+	return x + width - 1;
+}
+
+/**
+ * @brief
+ *     Release layers and buffers of the tile file
+ */
+static void ssd1306_tile_file_free(struct ssd1306_tile_file *file)
+{
+	int i;
+
+	for (i = 0; i < file->count; i++) {
+		if (file->panels[i].layer)
+			ssd1306_layer_destroy(file->panels[i].layer);
+		kfree(file->panels[i].rows);
+	}
+
+	ssd1306_cmode_free(&file->cmode);
+	kfree(file->surface);
+	kfree(file);
+}
+
+static int ssd1306_tile_open(struct inode *inode, struct file *fd)
+{
+	struct ssd1306_tile_file *file;
+	struct ssd1306_tile_panel *panel;
+	struct ssd1306 *oled;
+	int width, height;
+	int err = 0;
+	int i;
+
+	file = kzalloc(sizeof(*file), GFP_KERNEL);
+	if (!file)
+		return -ENOMEM;
+
+	mutex_lock(&ssd1306_tile.lock);
+
+	for (i = 0; i < SSD1306_TILE_MAX; i++) {
+		oled = ssd1306_tile.panels[i];
+		if (!oled)
+			continue;
+
+		width = ssd1306_width(oled);
+		height = ssd1306_height(oled);
+
+		/* Layer keeps the panel geometry until the file is closed,
+		 * see ssd1306_set_orientation()
+		 */
+		panel = &file->panels[file->count];
+		panel->layer = ssd1306_layer_create(oled);
+		if (IS_ERR(panel->layer)) {
+			err = PTR_ERR(panel->layer);
+			panel->layer = NULL;
+			goto err_free;
+		}
+
+		file->count++;
+		panel->oled = oled;
+		panel->x = file->width;
+		panel->width = width;
+		INIT_WORK(&panel->work, ssd1306_tile_work);
+
+		if (file->height && file->height != height) {
+			LOG(KERN_WARNING, "Tiled panels have different height");
+			err = -EINVAL;
+			goto err_free;
+		}
+
+		panel->rows = kmalloc(width / 8 * height, GFP_KERNEL);
+		if (!panel->rows) {
+			err = -ENOMEM;
+			goto err_free;
+		}
+
+		file->width += width;
+		file->height = height;
+	}
+
+	if (!file->count) {
+		err = -ENODEV;
+		goto err_free;
+	}
+
+	file->stride = file->width / 8;
+	file->surface = kzalloc(file->stride * file->height, GFP_KERNEL);
+	if (!file->surface) {
+		err = -ENOMEM;
+		goto err_free;
+	}
+
+	err = ssd1306_cmode_setup(&file->cmode, DEFAULT_FONT_WIDTH,
+				  DEFAULT_FONT_HEIGHT, file->width,
+				  file->height);
+	if (err)
+		goto err_free;
+
+	list_add(&file->node, &ssd1306_tile.files);
+
+	mutex_unlock(&ssd1306_tile.lock);
+
+	fd->private_data = file;
+
+	return 0;
+
+err_free:
+	ssd1306_tile_file_free(file);
+	mutex_unlock(&ssd1306_tile.lock);
+
+	return err;
+}
+
+static int ssd1306_tile_release(struct inode *inode, struct file *fd)
+{
+	struct ssd1306_tile_file *file = fd->private_data;
+
+	if (!file)
+		return 0;
+
+	mutex_lock(&ssd1306_tile.lock);
+	list_del(&file->node);
+	ssd1306_tile_file_free(file);
+	mutex_unlock(&ssd1306_tile.lock);
+
+	fd->private_data = NULL;
+
+	return 0;
+}
+
+static ssize_t ssd1306_tile_write(struct file *fd, const char __user *user,
+				  size_t size, loff_t *loff)
+{
+	struct ssd1306_tile_file *file = fd->private_data;
+	char *str;
+	int sent_chars;
+	int line;
+	int err;
+
+	if (!file)
+		return -EPERM;
+
+	str = kzalloc(size + 1, GFP_KERNEL);
+	if (!str)
+		return -ENOMEM;
+
+	if (copy_from_user(str, user, size)) {
+		kfree(str);
+		return -EFAULT;
+	}
+
+	mutex_lock(&ssd1306_tile.lock);
+
+	sent_chars = ssd1306_cut_str(&file->cmode, str);
+	if (sent_chars < 0)
+		goto unlock;
+
+	memset(file->surface, 0, file->stride * file->height);
+
+	for (line = 0; line < file->cmode.max_lines; line++)
+		ssd1306_tile_print(file, line * DEFAULT_FONT_HEIGHT,
+				   file->cmode.actual_disp[line]);
+
+	err = ssd1306_tile_flush(file, 0, file->width - 1);
+	if (err)
+		LOG(KERN_DEBUG, "Write to the tiled display failure");
+
+unlock:
+	mutex_unlock(&ssd1306_tile.lock);
+	kfree(str);
+
+	return sent_chars;
+}
+
+/**
+ * @brief
+ *     Copy 1bpp image from user space into the surface
+ *
+ * @return returns zero or negative error
+ */
+static int ssd1306_tile_ioctl_image(struct ssd1306_tile_file *file,
+				    struct ssd1306_image __user *argp)
+{
+	struct ssd1306_image image;
+	int width, height;
+	int raster;
+	uint8_t *data;
+	int x1;
+	int err;
+
+	if (copy_from_user(&image, argp, sizeof(image)))
+		return -EFAULT;
+
+	data = ssd1306_image_load(&image, &width, &height, &raster);
+	if (IS_ERR(data))
+		return PTR_ERR(data);
+
+	mutex_lock(&ssd1306_tile.lock);
+
+	if (image.x < 0 || image.x >= file->width ||
+	    image.y < 0 || image.y >= file->height) {
+		err = -EINVAL;
+		goto unlock;
+	}
+
+	if (image.flags & SSD1306_IMAGE_CLEAR)
+		memset(file->surface, 0, file->stride * file->height);
+
+	x1 = ssd1306_tile_blit(file, image.x, image.y, width, height,
+			       &data[raster]);
+
+	if (image.flags & SSD1306_IMAGE_CLEAR)
+		err = ssd1306_tile_flush(file, 0, file->width - 1);
+	else
+		err = ssd1306_tile_flush(file, image.x, x1);
+
+unlock:
+	mutex_unlock(&ssd1306_tile.lock);
+	kfree(data);
+
+	return err;
+}
+
+static long ssd1306_tile_ioctl(struct file *fd, unsigned int cmd,
+			       unsigned long arg)
+{
+	struct ssd1306_tile_file *file = fd->private_data;
+
+	if (!file)
+		return -EPERM;
+
+	switch (cmd) {
+	case SSD1306_IOC_IMAGE:
+		return ssd1306_tile_ioctl_image(file, (void __user *)arg);
+
+	default:
+		return -ENOTTY;
+	}
+}
+
+static struct file_operations ssd1306_tile_fops = {
+	.owner = THIS_MODULE,
+	.write = ssd1306_tile_write,
+	.open = ssd1306_tile_open,
+	.release = ssd1306_tile_release,
+	.unlocked_ioctl = ssd1306_tile_ioctl,
+};
+
+/**
+ * @brief
+ *     Place the panel into the tiled canvas or take it out
+ *
+ * @param[IN] oled     pointer to SSD1306 main handle
+ * @param[IN] index    position from the left, negative to leave the canvas
+ *
+ * @return returns zero or negative error
+ */
+int ssd1306_tile_set(struct ssd1306 *oled, int index)
+{
+	int err = 0;
+
+	if (index >= SSD1306_TILE_MAX)
+		return -EINVAL;
+
+	mutex_lock(&ssd1306_tile.lock);
+
+	if (!list_empty(&ssd1306_tile.files)) {
+		err = -EBUSY;
+		goto unlock;
+	}
+
+	if (index >= 0 && ssd1306_tile.panels[index] &&
+	    ssd1306_tile.panels[index] != oled) {
+		err = -EBUSY;
+		goto unlock;
+	}
+
+	if (oled->tile_index >= 0)
+		ssd1306_tile.panels[oled->tile_index] = NULL;
+
+	if (index >= 0)
+		ssd1306_tile.panels[index] = oled;
+
+	oled->tile_index = max(index, -1);
+
+unlock:
+	mutex_unlock(&ssd1306_tile.lock);
+
+	return err;
+}
+
+/**
+ * @brief
+ *     Take removed panel out of the canvas and out of the open files
+ *
+ * @param[IN] oled    pointer to SSD1306 main handle
+ */
+void ssd1306_tile_remove(struct ssd1306 *oled)
+{
+	struct ssd1306_tile_file *file;
+	int i;
+
+	mutex_lock(&ssd1306_tile.lock);
+
+	if (oled->tile_index < 0)
+		goto unlock;
+
+	list_for_each_entry(file, &ssd1306_tile.files, node) {
+		for (i = 0; i < file->count; i++) {
+			if (file->panels[i].oled != oled)
+				continue;
+
+			ssd1306_layer_destroy(file->panels[i].layer);
+			file->panels[i].layer = NULL;
+			file->panels[i].oled = NULL;
+		}
+	}
+
+	ssd1306_tile.panels[oled->tile_index] = NULL;
+	oled->tile_index = -1;
+
+unlock:
+	mutex_unlock(&ssd1306_tile.lock);
+}
+
+/**
+ * @brief
+ *     Create the tiled canvas device, panels join it later
+ *
+ * @param[IN] class    device class of the driver
+ * @param[IN] devt     device number of the canvas
+ *
+ * @return returns zero or negative error
+ */
+int ssd1306_tile_init(struct class *class, dev_t devt)
+{
+	struct device *device;
+	int err;
+
+	mutex_init(&ssd1306_tile.lock);
+	INIT_LIST_HEAD(&ssd1306_tile.files);
+
+	cdev_init(&ssd1306_tile.char_dev, &ssd1306_tile_fops);
+
+	err = cdev_add(&ssd1306_tile.char_dev, devt, 1);
+	if (err) {
+		LOG(KERN_ALERT, "Tile character device failed to add");
+		return err;
+	}
+
+	device = device_create(class, NULL, devt, NULL, TILE_NAME);
+	if (IS_ERR(device)) {
+		LOG(KERN_ALERT, "Cannot create tile device");
+		cdev_del(&ssd1306_tile.char_dev);
+		return PTR_ERR(device);
+	}
+
+	ssd1306_tile.class = class;
+
+	return 0;
+}
+
+/**
+ * @brief
+ *     Destroy the tiled canvas device
+ */
+void ssd1306_tile_exit(void)
+{
+	device_destroy(ssd1306_tile.class, ssd1306_tile.char_dev.dev);
+	cdev_del(&ssd1306_tile.char_dev);
+}
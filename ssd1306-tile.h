@@ -0,0 +1,9 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+
+#define TILE_NAME           DEVICE_NAME "-tile"
+#define SSD1306_TILE_MAX    SSD1306_DEVICES_MAX
+
+int ssd1306_tile_init(struct class *class, dev_t devt);
+void ssd1306_tile_exit(void);
+int ssd1306_tile_set(struct ssd1306 *oled, int index);
+void ssd1306_tile_remove(struct ssd1306 *oled);
@@ -3,14 +3,24 @@
 #include <linux/kernel.h>
 #include <linux/module.h>
 #include <linux/cdev.h>
+#include <linux/list.h>
+#include <linux/mutex.h>
+#include <linux/wait.h>
+#include <linux/atomic.h>
+#include <linux/ktime.h>
+#include <linux/workqueue.h>
 
 #include "ssd1306-cmds.h"
 
 #define CLASS_NAME     "oled"
 #define DEVICE_NAME    "ssd1306"
 
+//Panels get the first minors, tiled canvas the one after them
+#define SSD1306_DEVICES_MAX    4
+#define SSD1306_TILE_MINOR     SSD1306_DEVICES_MAX
+
 #define MINOR_BASE     0
-#define MINOR_COUNT    1
+#define MINOR_COUNT    (SSD1306_DEVICES_MAX + 1)
 
 /**
  * TODO: These values should be taken from device tree
@@ -18,6 +28,10 @@
 #define SSD1306_VERTICAL_MAX 32
 #define SSD1306_HORIZONTAL_MAX 128
 #define SSD1306_CELL_CAPACITY 8
+#define SSD1306_PAGES (SSD1306_VERTICAL_MAX / SSD1306_CELL_CAPACITY)
+//Controller RAM, rows below the panel height are not shown
+#define SSD1306_RAM_ROWS 64
+#define SSD1306_RAM_PAGES (SSD1306_RAM_ROWS / SSD1306_CELL_CAPACITY)
 
 
 #define LOG(sev, ...) printk(sev "ssd1306: " __VA_ARGS__)
@@ -29,21 +43,104 @@
  *       transmission.
 */
 #define DISP_BUFF_SIZE    (512 + 1)
+//Display data follows the single command byte of the data stream
+#define DISP_BUFF_OFFSET  1
+
+#define SSD1306_SPRITES_MAX    32
+
+/**
+ * Panel timing programmed during initialization. Clock, precharge and VCOMH
+ * are defaults, they can be changed by device tree or sysfs.
+ */
+#define SSD1306_MLTPLX_RATIO       (SSD1306_VERTICAL_MAX - 1)
+#define SSD1306_DISP_CLOCK_DEV     0x80
+#define SSD1306_PRECHARGE_PERIOD   0x22
+#define SSD1306_VCOMH_LEVEL        0x20
+
+struct ssd1306_gray;
+struct ssd1306_orbit;
+struct ssd1306_effects;
+struct dentry;
+
+struct ssd1306_sprite;
+
+struct ssd1306_cmode_attr {
+	uint8_t scale_x;    /*! Horizontal scale of the line text */
+	uint8_t scale_y;    /*! Vertical scale of the line text */
+};
 
 struct ssd1306_cmode{
 	int max_cols;       /*! Max. characters in single line */
 	int max_lines;      /*! Max. lines on the display */
 	int max_buff_size;  /*! Max. display capacity */
 	char **actual_disp; /*! Array contains actually displaying strings */
+	struct ssd1306_cmode_attr *line_attr; /*! Attributes of every line */
+};
+
+/**
+ * Controller configuration last written to the panel. Commands which would
+ * not change it are not sent. Fields are -1 while the value is unknown.
+ */
+struct ssd1306_state {
+	int addr_mode;      /*! Memory addressing mode */
+	int col_start;      /*! Column window */
+	int col_end;
+	int page_start;     /*! Page window */
+	int page_end;
+	int contrast;       /*! Contrast control */
+	int invert;         /*! SET_DISP_NORMAL or SET_DISP_INVERT */
+	int disp_on;        /*! SET_DISP_ON or SET_DISP_OFF */
+	int charge_pump;    /*! ENABLE_CHARGE_PUMP or DISABLE_CHARGE_PUMP */
+	int start_line;     /*! SET_DISP_START_LINE with the line */
+	int offset;         /*! Display offset */
+	int seg_remap;      /*! Segment re-map command */
+	int com_dir;        /*! COM output scan direction command */
+	int clock;          /*! Clock divide ratio and oscillator frequency */
+	int precharge;      /*! Precharge period */
+	int vcomh;          /*! VCOMH deselect level */
 };
 
 struct ssd1306 {
 	struct cdev char_dev;
 	struct device *device;
 	struct i2c_client *i2c_client;
-	struct ssd1306_cmode cmode;
+	struct ssd1306_state state;     /*! Shadow of controller registers */
 	uint8_t *disp_buff;
-
+	uint8_t *canvas;     /*! Composed image, disp_buff unless transposed */
+	uint8_t *rot_buff;   /*! Canvas of 90 and 270 degrees rotation */
+	int width;           /*! Canvas width, panel height when transposed */
+	int height;          /*! Canvas height, panel width when transposed */
+	int rotation;        /*! Clockwise rotation: 0, 90, 180 or 270 */
+	bool mirror_x;       /*! Mirror panel columns */
+	bool mirror_y;       /*! Mirror panel rows */
+	uint8_t *base_buff;  /*! Content left behind by closed layers */
+	uint8_t *tx_buff;    /*! Scratch buffer for partial transfers */
+	uint8_t *sent_buff;  /*! Data the panel received, GDDRAM mirror */
+	bool sent_stale;     /*! Panel RAM may differ from sent_buff */
+	int dirty_start[SSD1306_PAGES]; /*! First changed column per page */
+	int dirty_end[SSD1306_PAGES];   /*! Last changed column per page */
+	struct list_head layers;        /*! Open file layers sorted by z */
+	struct mutex lock;              /*! Protects buffers, layers and bus */
+	atomic64_t frame_submitted;     /*! Frames handed to the bus */
+	atomic64_t frame_completed;     /*! Frames finished on the bus */
+	ktime_t frame_time;             /*! Completion time of last frame */
+	int frame_err;                  /*! Result of last frame transfer */
+	wait_queue_head_t frame_wait;   /*! Woken on every finished frame */
+	struct ssd1306_sprite *sprites[SSD1306_SPRITES_MAX]; /*! Bitmap cache */
+	struct ssd1306_gray *gray;      /*! Grayscale engine, when enabled */
+	struct mutex gray_lock;         /*! Serializes grayscale mode users */
+	struct dentry *debugfs;         /*! Frame capture directory */
+	int tile_index;                 /*! Position in tiled canvas or -1 */
+	struct ssd1306_orbit *orbit;    /*! Burn-in orbit timer */
+	int shift_x;                    /*! Image shift right on the panel */
+	int shift_y;                    /*! Image shift down on the panel */
+	struct ssd1306_effects *effects; /*! Contrast fades and blinking */
+	uint8_t contrast;               /*! Contrast shown without effect */
+	uint8_t clock;       /*! Divide ratio - 1 (low), oscillator freq. (high) */
+	uint8_t precharge;   /*! Phase 1 (low) and phase 2 (high) in DCLKs */
+	uint8_t vcomh;       /*! VCOMH deselect level */
+	struct work_struct mailbox_work; /*! Sends newest submitted frames */
+	atomic64_t frames_dropped;       /*! Submitted frames never sent */
 };
 
 int ssd1306_init_hw(struct ssd1306 *oled);
@@ -51,5 +148,107 @@ void ssd1306_deinit_hw(struct ssd1306 *oled);
 int ssd1306_display(struct ssd1306 *oled);
 int ssd1306_clear_display(struct ssd1306 *oled);
 int ssd1306_draw_pxl(struct ssd1306 *oled, int x, int y);
+int ssd1306_draw_pxl_buff(struct ssd1306 *oled, uint8_t *buff, int x, int y);
+void ssd1306_mark_dirty(struct ssd1306 *oled, int x0, int y0, int x1, int y1);
+int ssd1306_display_area(struct ssd1306 *oled, int col_start, int page_start,
+			 int col_end, int page_end);
+int ssd1306_display_dirty(struct ssd1306 *oled);
+int ssd1306_refresh_rate(struct ssd1306 *oled);
+void ssd1306_rotate_area(struct ssd1306 *oled, int x0, int y0, int x1, int y1);
+int ssd1306_set_orientation(struct ssd1306 *oled, int rotation, bool mirror_x,
+			    bool mirror_y);
+void ssd1306_state_invalidate(struct ssd1306 *oled);
+int ssd1306_set_contrast(struct ssd1306 *oled, uint8_t contrast);
+int ssd1306_set_invert(struct ssd1306 *oled, bool invert);
+int ssd1306_set_start_line(struct ssd1306 *oled, int line);
+int ssd1306_set_offset(struct ssd1306 *oled, int offset);
+int ssd1306_set_timing(struct ssd1306 *oled, uint8_t clock, uint8_t precharge,
+		       uint8_t vcomh);
 int ssd1306_enable_charge_pump(struct ssd1306* oled, bool enable);
 int ssd1306_enable_display(struct ssd1306* oled, bool enable);
+
+/**
+ * @brief
+ *     Calculate which bits of a page byte belong to rows top..bottom
+ *
+ * @param[IN] page      page number
+ * @param[IN] top       first row
+ * @param[IN] bottom    last row (inclusive)
+ *
+ * @return returns mask of the rows in the page
+ */
+static inline uint8_t ssd1306_page_mask(int page, int top, int bottom)
+{
+	const int first = max(top - page * SSD1306_CELL_CAPACITY, 0);
+	const int last = min(bottom - page * SSD1306_CELL_CAPACITY,
+			     SSD1306_CELL_CAPACITY - 1);
+
+	if (first > last)
+		return 0;
+
+	return (uint8_t)((0xFF << first) & (0xFF >> (7 - last)));
+}
+
+/**
+ * @brief
+ *     Canvas is stored transposed to the panel (90 or 270 degrees rotation)
+ */
+static inline bool ssd1306_transposed(struct ssd1306 *oled)
+{
+#ifdef CONFIG_SSD1306_FIXED_GEOMETRY
+	return false;
+#else
+	return oled->rotation == 90 || oled->rotation == 270;
+#endif
+}
+
+/**
+ * @brief
+ *     Canvas width. Fixed geometry build never transposes the canvas, so
+ *     width, stride and page count are compile-time constants and the
+ *     renderers are specialized for them.
+ */
+static inline int ssd1306_width(struct ssd1306 *oled)
+{
+#ifdef CONFIG_SSD1306_FIXED_GEOMETRY
+	return SSD1306_HORIZONTAL_MAX;
+#else
+	return oled->width;
+#endif
+}
+
+/**
+ * @brief
+ *     Canvas height, compile-time constant in fixed geometry build
+ */
+static inline int ssd1306_height(struct ssd1306 *oled)
+{
+#ifdef CONFIG_SSD1306_FIXED_GEOMETRY
+	return SSD1306_VERTICAL_MAX;
+#else
+	return oled->height;
+#endif
+}
+
+/**
+ * @brief
+ *     Transpose 8x8 bit matrix in a single word: bit 8 * r + c of the input
+ *     becomes bit 8 * c + r of the result.
+ *
+ * @param[IN] x    eight bytes of the matrix
+ *
+ * @return returns transposed matrix
+ */
+static inline u64 ssd1306_transpose8(u64 x)
+{
+	u64 t;
+
+	t = (x ^ (x >> 7)) & 0x00AA00AA00AA00AAULL;
+	x = x ^ t ^ (t << 7);
+	t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCULL;
+	x = x ^ t ^ (t << 14);
+	t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ULL;
+	x = x ^ t ^ (t << 28);
+
+	return x;
+}